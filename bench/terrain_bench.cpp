@@ -0,0 +1,468 @@
+// Microbenchmarks for the CPU generation stages (noise, heightfield, erosion, water, normals).
+// Run with e.g. ./terrain_bench --benchmark_filter=BaseTerrain to pick a subset.
+#include <benchmark/benchmark.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <vector>
+#include "PerlinNoise.hpp"
+#include "Profiler.hpp"
+#include "TerrainLod.hpp"
+#include "TerrainMesh.hpp"
+#include "ThreadPool.hpp"
+#include "math.hpp"
+
+namespace {
+
+const int WIDTH = 1024; // Same unit as main.cpp
+
+// Terrain parameters used by main.cpp for the default command line
+const double frequency = 3.0, amplitude = 0.5, persistence = 0.5, lacunarity = 2.0;
+const int octave = 10, seed = 42;
+
+// Convert the --width/--lod command line values into the width/step Terrain::init expects
+int terrainWidth(int widthOption) { return WIDTH * widthOption; }
+int terrainStep(int widthOption, int lodOption) { return terrainWidth(widthOption) / (32 * (1 << lodOption)); }
+
+// Attach allocation and memory counters; bytes are per iteration, peak RSS is for the whole process so far
+void reportMemory(benchmark::State& state, long long bytes) {
+    state.counters["bytes_alloc"] = benchmark::Counter(static_cast<double>(bytes),
+                                                       benchmark::Counter::kAvgIterations, benchmark::Counter::kIs1024);
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    state.counters["peak_rss_kb"] = static_cast<double>(usage.ru_maxrss);
+}
+
+// Random sample positions in the range the heightfield uses after frequency scaling
+void randomPositions(std::vector<double>& x, std::vector<double>& y, std::size_t count) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> dist(-64.0, 64.0);
+    x.resize(count);
+    y.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        x[i] = dist(rng);
+        y[i] = dist(rng);
+    }
+}
+
+// Width/lod grid swept by the terrain benchmarks: {width, lod}
+void terrainSizes(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({"width", "lod"});
+    bench->ArgsProduct({{1, 3, 6, 9, 13}, {0, 1, 2, 3, 4, 5}});
+    bench->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+static void BM_Noise(benchmark::State& state) {
+    PerlinNoise perlinNoise(seed);
+    std::vector<double> x, y;
+    randomPositions(x, y, 4096);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < x.size(); ++i) {
+            benchmark::DoNotOptimize(perlinNoise.noise(x[i], y[i], 0.5));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+BENCHMARK(BM_Noise);
+
+// Compile-time noise variants against BM_Noise (the double 3D path the terrain uses)
+template <typename Real, int Dimensions>
+static void BM_NoiseVariant(benchmark::State& state) {
+    PerlinNoise perlinNoise(seed);
+    std::vector<double> x, y;
+    randomPositions(x, y, 4096);
+    std::vector<Real> xs(x.begin(), x.end()), ys(y.begin(), y.end());
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            benchmark::DoNotOptimize(perlinNoise.noise<Real, Dimensions>(xs[i], ys[i], Real(0.5)));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * xs.size());
+}
+BENCHMARK_TEMPLATE(BM_NoiseVariant, double, 3);
+BENCHMARK_TEMPLATE(BM_NoiseVariant, float, 3);
+BENCHMARK_TEMPLATE(BM_NoiseVariant, double, 2);
+BENCHMARK_TEMPLATE(BM_NoiseVariant, float, 2);
+BENCHMARK_TEMPLATE(BM_NoiseVariant, Fixed16, 3);
+BENCHMARK_TEMPLATE(BM_NoiseVariant, Fixed16, 2);
+
+// Batch kernel at each SIMD level the CPU supports (0 = scalar, 1 = SSE4.1, 2 = AVX2)
+template <typename Scalar>
+static void BM_NoiseBatch(benchmark::State& state) {
+    const SimdLevel level = static_cast<SimdLevel>(state.range(0));
+    if (level > PerlinNoise::detectSimdLevel()) {
+        state.SkipWithError("SIMD level not supported on this CPU");
+        return;
+    }
+    const SimdLevel previous = PerlinNoise::getSimdLevel();
+    PerlinNoise::setSimdLevel(level);
+
+    PerlinNoise perlinNoise(seed);
+    std::vector<double> x, y;
+    randomPositions(x, y, 4096);
+    std::vector<Scalar> xs(x.begin(), x.end()), ys(y.begin(), y.end()), out(x.size());
+    for (auto _ : state) {
+        perlinNoise.noiseBatch(xs.data(), ys.data(), Scalar(0.5), xs.size(), out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * xs.size());
+    PerlinNoise::setSimdLevel(previous);
+}
+BENCHMARK_TEMPLATE(BM_NoiseBatch, double)->ArgName("simd")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_NoiseBatch, float)->ArgName("simd")->DenseRange(0, 2);
+
+static void BM_GenerateNoise(benchmark::State& state) {
+    const int octaves = static_cast<int>(state.range(0));
+    PerlinNoise perlinNoise(seed);
+    std::vector<double> x, y;
+    randomPositions(x, y, 1024);
+    for (auto& v : x) v /= 64.0;
+    for (auto& v : y) v /= 64.0;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < x.size(); ++i) {
+            benchmark::DoNotOptimize(perlinNoise.generateNoise(x[i], y[i], 0.5, frequency, amplitude, octaves, persistence, lacunarity));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+BENCHMARK(BM_GenerateNoise)->ArgName("octave")->Arg(2)->Arg(5)->Arg(10)->Arg(15)->Arg(20);
+
+// generateNoise with the default 10 octaves fixed at compile time, per scalar type and dimension
+template <typename Real, int Dimensions>
+static void BM_GenerateNoiseFixedOctaves(benchmark::State& state) {
+    PerlinNoise perlinNoise(seed);
+    std::vector<double> x, y;
+    randomPositions(x, y, 1024);
+    std::vector<Real> xs, ys;
+    for (double v : x) xs.push_back(static_cast<Real>(v / 64.0));
+    for (double v : y) ys.push_back(static_cast<Real>(v / 64.0));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+            benchmark::DoNotOptimize(perlinNoise.generateNoise<octave, Real, Dimensions>(xs[i], ys[i], Real(0.5), Real(frequency), Real(amplitude),
+                                                                                      Real(persistence), Real(lacunarity)));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * xs.size());
+}
+BENCHMARK_TEMPLATE(BM_GenerateNoiseFixedOctaves, double, 3);
+BENCHMARK_TEMPLATE(BM_GenerateNoiseFixedOctaves, float, 3);
+BENCHMARK_TEMPLATE(BM_GenerateNoiseFixedOctaves, double, 2);
+BENCHMARK_TEMPLATE(BM_GenerateNoiseFixedOctaves, float, 2);
+BENCHMARK_TEMPLATE(BM_GenerateNoiseFixedOctaves, Fixed16, 3);
+BENCHMARK_TEMPLATE(BM_GenerateNoiseFixedOctaves, Fixed16, 2);
+
+static void BM_GenerateNoiseBatch(benchmark::State& state) {
+    const int octaves = static_cast<int>(state.range(0));
+    PerlinNoise perlinNoise(seed);
+    std::vector<double> x, y;
+    randomPositions(x, y, 1024);
+    for (auto& v : x) v /= 64.0;
+    for (auto& v : y) v /= 64.0;
+    std::vector<double> out(x.size());
+    for (auto _ : state) {
+        perlinNoise.generateNoiseBatch(x.data(), y.data(), 0.5, x.size(), out.data(), frequency, amplitude, octaves, persistence, lacunarity);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+BENCHMARK(BM_GenerateNoiseBatch)->ArgName("octave")->Arg(2)->Arg(5)->Arg(10)->Arg(15)->Arg(20);
+
+// Heightfield and terrain mesh on the calling thread, then on a pool with one thread per core
+static void BM_GenerateBaseTerrain(benchmark::State& state) {
+    const int width = terrainWidth(static_cast<int>(state.range(0)));
+    const int step = terrainStep(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    const long long bytesBefore = Profiler::getAllocatedBytes();
+    for (auto _ : state) {
+        TerrainMesh mesh;
+        mesh.init(width, step, seed);
+        mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+        benchmark::DoNotOptimize(mesh.getVerticesWithNormals().data());
+    }
+    state.SetItemsProcessed(state.iterations() * (width / step) * (width / step));
+    reportMemory(state, Profiler::getAllocatedBytes() - bytesBefore);
+}
+BENCHMARK(BM_GenerateBaseTerrain)->Apply(terrainSizes);
+
+// BM_GenerateBaseTerrain with the noise summed by the float kernel (--float-noise)
+static void BM_GenerateBaseTerrainFloatNoise(benchmark::State& state) {
+    const int width = terrainWidth(static_cast<int>(state.range(0)));
+    const int step = terrainStep(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    const long long bytesBefore = Profiler::getAllocatedBytes();
+    for (auto _ : state) {
+        TerrainMesh mesh;
+        mesh.setFloatNoise(true);
+        mesh.init(width, step, seed);
+        mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+        benchmark::DoNotOptimize(mesh.getVerticesWithNormals().data());
+    }
+    state.SetItemsProcessed(state.iterations() * (width / step) * (width / step));
+    reportMemory(state, Profiler::getAllocatedBytes() - bytesBefore);
+}
+BENCHMARK(BM_GenerateBaseTerrainFloatNoise)->Apply(terrainSizes);
+
+static void BM_GenerateBaseTerrainThreaded(benchmark::State& state) {
+    static ThreadPool pool;
+    const int width = terrainWidth(static_cast<int>(state.range(0)));
+    const int step = terrainStep(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    const long long bytesBefore = Profiler::getAllocatedBytes();
+    for (auto _ : state) {
+        TerrainMesh mesh;
+        mesh.setThreadPool(&pool);
+        mesh.init(width, step, seed);
+        mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+        benchmark::DoNotOptimize(mesh.getVerticesWithNormals().data());
+    }
+    state.SetItemsProcessed(state.iterations() * (width / step) * (width / step));
+    state.counters["threads"] = pool.getThreadCount();
+    reportMemory(state, Profiler::getAllocatedBytes() - bytesBefore);
+}
+BENCHMARK(BM_GenerateBaseTerrainThreaded)->Apply(terrainSizes)->UseRealTime();
+
+// Base terrain with --erosion; compare with BM_GenerateBaseTerrain at the same width and lod.
+// The threaded variant gives the same heights, split into row bands from width 6, lod 1 up.
+static void erodedTerrainSizes(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({"width", "lod", "iterations"});
+    bench->ArgsProduct({{6}, {0, 1, 3, 5}, {8, 64}});
+    bench->Unit(benchmark::kMillisecond);
+}
+
+static void BM_GenerateBaseTerrainEroded(benchmark::State& state) {
+    const int width = terrainWidth(static_cast<int>(state.range(0)));
+    const int step = terrainStep(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    ErosionSettings erosion;
+    erosion.iterations = static_cast<int>(state.range(2));
+    const long long bytesBefore = Profiler::getAllocatedBytes();
+    for (auto _ : state) {
+        TerrainMesh mesh;
+        mesh.setErosion(erosion);
+        mesh.init(width, step, seed);
+        mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+        benchmark::DoNotOptimize(mesh.getVerticesWithNormals().data());
+    }
+    state.SetItemsProcessed(state.iterations() * (width / step) * (width / step));
+    reportMemory(state, Profiler::getAllocatedBytes() - bytesBefore);
+}
+BENCHMARK(BM_GenerateBaseTerrainEroded)->Apply(erodedTerrainSizes);
+
+static void BM_GenerateBaseTerrainErodedThreaded(benchmark::State& state) {
+    static ThreadPool pool;
+    const int width = terrainWidth(static_cast<int>(state.range(0)));
+    const int step = terrainStep(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    ErosionSettings erosion;
+    erosion.iterations = static_cast<int>(state.range(2));
+    const long long bytesBefore = Profiler::getAllocatedBytes();
+    for (auto _ : state) {
+        TerrainMesh mesh;
+        mesh.setThreadPool(&pool);
+        mesh.setErosion(erosion);
+        mesh.init(width, step, seed);
+        mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+        benchmark::DoNotOptimize(mesh.getVerticesWithNormals().data());
+    }
+    state.SetItemsProcessed(state.iterations() * (width / step) * (width / step));
+    state.counters["threads"] = pool.getThreadCount();
+    reportMemory(state, Profiler::getAllocatedBytes() - bytesBefore);
+}
+BENCHMARK(BM_GenerateBaseTerrainErodedThreaded)->Apply(erodedTerrainSizes)->UseRealTime();
+
+// Regeneration with every octave already in a NoiseLayerCache, e.g. after a persistence change:
+// only the weighted re-sum and the scaling run, no noise is evaluated
+static void BM_GenerateBaseTerrainFromLayers(benchmark::State& state) {
+    const int width = terrainWidth(static_cast<int>(state.range(0)));
+    const int step = terrainStep(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    NoiseLayerCache layers;
+    {
+        TerrainMesh mesh;
+        mesh.setNoiseLayers(&layers);
+        mesh.init(width, step, seed);
+        mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+    }
+    const long long bytesBefore = Profiler::getAllocatedBytes();
+    for (auto _ : state) {
+        TerrainMesh mesh;
+        mesh.setNoiseLayers(&layers);
+        mesh.init(width, step, seed);
+        mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+        benchmark::DoNotOptimize(mesh.getVerticesWithNormals().data());
+    }
+    state.SetItemsProcessed(state.iterations() * (width / step) * (width / step));
+    state.counters["layer_bytes"] = benchmark::Counter(static_cast<double>(layers.getLayerCount() * layers.getSampleCount() * sizeof(double)),
+                                                       benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+    reportMemory(state, Profiler::getAllocatedBytes() - bytesBefore);
+}
+BENCHMARK(BM_GenerateBaseTerrainFromLayers)->Apply(terrainSizes);
+
+static void BM_GenerateWater(benchmark::State& state) {
+    const int width = terrainWidth(static_cast<int>(state.range(0)));
+    const int step = terrainStep(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    long long bytes = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        TerrainMesh mesh;
+        mesh.init(width, step, seed);
+        mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+        const long long bytesBefore = Profiler::getAllocatedBytes();
+        state.ResumeTiming();
+
+        mesh.generateWater();
+
+        state.PauseTiming();
+        bytes += Profiler::getAllocatedBytes() - bytesBefore;
+        benchmark::DoNotOptimize(mesh.getVerticesWithNormals().data());
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * (width / step) * (width / step));
+    reportMemory(state, bytes);
+}
+BENCHMARK(BM_GenerateWater)->Apply(terrainSizes);
+
+// The generic triangle-walking normals of math.hpp, on the terrain grid as a 6-float indexed mesh
+static void BM_ComputeVertexNormals(benchmark::State& state) {
+    const int width = terrainWidth(static_cast<int>(state.range(0)));
+    const int step = terrainStep(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    TerrainMesh mesh;
+    mesh.init(width, step, seed);
+    mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+    mesh.generateWater();
+
+    const int columns = width / step;
+    const std::vector<float>& grid = mesh.getVerticesWithNormals();
+    std::vector<float> vertices;
+    for (size_t i = 0; i < grid.size(); i += 9) {
+        vertices.insert(vertices.end(), {grid[i], grid[i + 1], grid[i + 2], grid[i + 6], grid[i + 7], grid[i + 8]});
+    }
+    std::vector<unsigned int> indices;
+    for (int y = 0; y < columns - 1; ++y) {
+        for (int x = 0; x < columns - 1; ++x) {
+            unsigned int start = y * columns + x;
+            indices.insert(indices.end(), {start, start + 1, start + columns + 1, start + columns + 1, start + columns, start});
+        }
+    }
+
+    const long long bytesBefore = Profiler::getAllocatedBytes();
+    for (auto _ : state) {
+        std::vector<float> normals;
+        computeVertexNormals(vertices, indices, normals);
+        benchmark::DoNotOptimize(normals.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (vertices.size() / 6));
+    reportMemory(state, Profiler::getAllocatedBytes() - bytesBefore);
+}
+BENCHMARK(BM_ComputeVertexNormals)->Apply(terrainSizes);
+
+// The grid normal path used by the terrain, gathering from neighbouring heights across the pool's threads
+static void BM_GenerateTerrainNormals(benchmark::State& state) {
+    static ThreadPool pool;
+    const int width = terrainWidth(static_cast<int>(state.range(0)));
+    const int step = terrainStep(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    TerrainMesh mesh;
+    mesh.setThreadPool(&pool);
+    mesh.init(width, step, seed);
+    mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+    mesh.generateWater();
+
+    const long long bytesBefore = Profiler::getAllocatedBytes();
+    for (auto _ : state) {
+        mesh.generateTerrainNormals();
+        benchmark::DoNotOptimize(mesh.getVerticesWithNormals().data());
+    }
+    state.SetItemsProcessed(state.iterations() * (width / step) * (width / step));
+    state.counters["threads"] = pool.getThreadCount();
+    reportMemory(state, Profiler::getAllocatedBytes() - bytesBefore);
+}
+BENCHMARK(BM_GenerateTerrainNormals)->Apply(terrainSizes)->UseRealTime();
+
+// Frustum of the viewer's projection (45 degrees, 800x600, near 10, far 10000) looking down -z from cameraPos
+static Frustum viewerFrustum(const Vec& cameraPos) {
+    const float f = 1.0f / std::tan(radians(45.0f) / 2.0f);
+    const float nearPlane = 10.0f, farPlane = 10000.0f;
+    const float projection[16] = {f / (800.0f / 600.0f), 0, 0, 0,
+                                  0, f, 0, 0,
+                                  0, 0, (farPlane + nearPlane) / (nearPlane - farPlane), -1,
+                                  0, 0, 2 * farPlane * nearPlane / (nearPlane - farPlane), 0};
+    const float view[16] = {1, 0, 0, 0,
+                            0, 1, 0, 0,
+                            0, 0, 1, 0,
+                            -cameraPos.x, -cameraPos.y, -cameraPos.z, 1};
+    return extractFrustum(projection, view);
+}
+
+// Per-frame cost of picking and culling patch levels; the triangles counter is what a frame would draw
+static void BM_SelectLodLevels(benchmark::State& state) {
+    const int width = terrainWidth(static_cast<int>(state.range(0)));
+    const int step = terrainStep(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    TerrainMesh mesh;
+    mesh.init(width, step, seed);
+    mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+    mesh.generateWater();
+    mesh.generateTerrainNormals();
+    TerrainLod lod;
+    lod.build(width / step, width / step, mesh.getVerticesWithNormals());
+
+    const Vec cameraPos = {0.0f, 0.0f, 1024.0f}; // Initial camera position of the viewer
+    const Frustum frustum = viewerFrustum(cameraPos);
+    for (auto _ : state) {
+        lod.selectLevels(cameraPos, 4.0f, frustum);
+        benchmark::DoNotOptimize(lod.getDraws().data());
+    }
+    state.SetItemsProcessed(state.iterations() * lod.getPatchCount());
+    state.counters["patches_drawn"] = lod.getVisiblePatchCount();
+    state.counters["triangles"] = static_cast<double>(lod.getTriangleCount());
+    state.counters["full_triangles"] = static_cast<double>(width / step - 1) * (width / step - 1) * 2;
+}
+BENCHMARK(BM_SelectLodLevels)->Apply(terrainSizes);
+
+// Post-transform cache misses per triangle (ACMR) for the draws of the last selectLevels call, with a
+// FIFO cache of cacheSize vertices. 0.5 is the best a regular grid can do, 3 means no reuse at all.
+static double averageCacheMissRatio(const TerrainLod& lod, size_t cacheSize) {
+    std::deque<unsigned int> cache;
+    unsigned long long misses = 0;
+    for (const TerrainLod::Draw& draw : lod.getDraws()) {
+        for (unsigned int i = draw.indexOffset; i < draw.indexOffset + draw.indexCount; ++i) {
+            unsigned int index = lod.getIndexSize() == 2 ? static_cast<const uint16_t*>(lod.getIndexData())[i]
+                                                         : static_cast<const unsigned int*>(lod.getIndexData())[i];
+            if (index == lod.getRestartIndex()) continue;
+            index += draw.baseVertex;
+            if (std::find(cache.begin(), cache.end(), index) != cache.end()) continue;
+            ++misses;
+            cache.push_back(index);
+            if (cache.size() > cacheSize) cache.pop_front();
+        }
+    }
+    return lod.getTriangleCount() == 0 ? 0.0 : static_cast<double>(misses) / lod.getTriangleCount();
+}
+
+// Building the patch index lists as triangle lists (mode 0) or strips (mode 1) at width 6. index_bytes is
+// the buffer uploaded to the GPU (16-bit at every lod), index_bytes_u32 the same lists as 32-bit indices,
+// and acmr the vertex cache behaviour of a full-detail frame.
+static void BM_BuildPatchIndices(benchmark::State& state) {
+    const TerrainLod::IndexMode mode = state.range(0) == 0 ? TerrainLod::IndexMode::Triangles : TerrainLod::IndexMode::Strips;
+    const int width = terrainWidth(6);
+    const int step = terrainStep(6, static_cast<int>(state.range(1)));
+    TerrainMesh mesh;
+    mesh.init(width, step, seed);
+    mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+    mesh.generateWater();
+    mesh.generateTerrainNormals();
+
+    TerrainLod lod;
+    const long long bytesBefore = Profiler::getAllocatedBytes();
+    for (auto _ : state) {
+        lod.build(width / step, width / step, mesh.getVerticesWithNormals(), mode);
+        benchmark::DoNotOptimize(lod.getIndexData());
+    }
+    reportMemory(state, Profiler::getAllocatedBytes() - bytesBefore);
+
+    const Vec cameraPos = {0.0f, 0.0f, 1024.0f};
+    lod.selectLevels(cameraPos, 0.0f, viewerFrustum(cameraPos));
+    state.counters["index_bytes"] = static_cast<double>(lod.getIndexBytes());
+    state.counters["index_bytes_u32"] = static_cast<double>(lod.getIndexBytes() / lod.getIndexSize() * sizeof(unsigned int));
+    state.counters["acmr"] = averageCacheMissRatio(lod, 32);
+}
+BENCHMARK(BM_BuildPatchIndices)->ArgNames({"strips", "lod"})->ArgsProduct({{0, 1}, {0, 1, 2, 3, 4, 5}})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
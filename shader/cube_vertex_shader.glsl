@@ -1,13 +1,25 @@
 #version 120
+#extension GL_ARB_uniform_buffer_object : enable
+
+// Per-frame matrices, declared as in sand_vertexShader.glsl
+#ifdef GL_ARB_uniform_buffer_object
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
+#else
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat4 viewProjection;
+#endif
 
 attribute vec3 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
 }
 
@@ -0,0 +1,79 @@
+#version 130
+
+// Fractal Perlin noise of one terrain grid vertex, the same sum PerlinNoise::generateNoiseBatch
+// computes in double precision, here in single precision. The lattice cell and fraction of every
+// sample coordinate come from tables GpuNoise fills in double precision, because high octaves scale
+// the coordinates past what a float can resolve. Writes noise + 1.5, the raw value TerrainMesh keeps
+// before scaling.
+
+uniform sampler2D permutation; // 512 x 1, the PerlinNoise table twice, one value per texel
+uniform sampler2D latticeX;    // columns x octaves: lattice cell (mod 256) and fraction of x * frequency
+uniform sampler2D latticeZ;    // rows x octaves, the same for z
+uniform int octaves;
+uniform float octaveAmplitude[32];
+uniform int octaveZCell[32];       // Lattice cell and fraction of the noise z = 0.5 * frequency per octave
+uniform float octaveZFraction[32];
+uniform float maxAmplitude;
+
+int perm(int i) {
+    return int(texelFetch(permutation, ivec2(i, 0), 0).r);
+}
+
+float fade(float t) {
+    return t * t * t * (t * (t * 6.0 - 15.0) + 10.0);
+}
+
+// a + t * (b - a) as in PerlinNoise, which rounds differently from mix()
+float lerp(float t, float a, float b) {
+    return a + t * (b - a);
+}
+
+// Dot product with one of the 12 gradient vectors of PerlinNoise::gradientVectors
+float grad(int hash, float x, float y, float z) {
+    int h = hash & 11;
+    if (h < 4) return h == 0 ? x : h == 1 ? -x : h == 2 ? y : -y;
+    if (h < 8) return (h == 4 || h == 6 ? x : -x) + (h < 6 ? y : -y);
+    return (h == 8 ? x : h == 9 ? -x : h == 10 ? y : -y) + z;
+}
+
+// PerlinNoise::noise with the sample split into its lattice cell (mod 256) and the fraction within it
+float noise(ivec3 cell, vec3 fraction) {
+    int X = cell.x;
+    int Y = cell.y;
+    int Z = cell.z;
+
+    float x = fraction.x;
+    float y = fraction.y;
+    float z = fraction.z;
+
+    float u = fade(x);
+    float v = fade(y);
+    float w = fade(z);
+
+    int A = perm(X) + Y;
+    int AA = perm(A) + Z;
+    int AB = perm(A + 1) + Z;
+    int B = perm(X + 1) + Y;
+    int BA = perm(B) + Z;
+    int BB = perm(B + 1) + Z;
+
+    float res = lerp(w, lerp(v, lerp(u, grad(perm(AA), x, y, z), grad(perm(BA), x - 1.0, y, z)),
+                                lerp(u, grad(perm(AB), x, y - 1.0, z), grad(perm(BB), x - 1.0, y - 1.0, z))),
+                        lerp(v, lerp(u, grad(perm(AA + 1), x, y, z - 1.0), grad(perm(BA + 1), x - 1.0, y, z - 1.0)),
+                                lerp(u, grad(perm(AB + 1), x, y - 1.0, z - 1.0), grad(perm(BB + 1), x - 1.0, y - 1.0, z - 1.0))));
+    return (res + 1.0) / 2.0;
+}
+
+void main() {
+    int column = int(gl_FragCoord.x);
+    int row = int(gl_FragCoord.y);
+
+    float value = 0.0;
+    for (int i = 0; i < octaves; ++i) {
+        vec2 x = texelFetch(latticeX, ivec2(column, i), 0).rg;
+        vec2 y = texelFetch(latticeZ, ivec2(row, i), 0).rg;
+        value += octaveAmplitude[i] * noise(ivec3(int(x.r), int(y.r), octaveZCell[i]), vec3(x.g, y.g, octaveZFraction[i]));
+    }
+    value = (2.0 * (value / maxAmplitude) - 1.0) * maxAmplitude;
+    gl_FragColor = vec4(value + 1.5, 0.0, 0.0, 1.0);
+}
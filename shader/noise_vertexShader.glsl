@@ -0,0 +1,9 @@
+#version 130
+
+// Full-screen quad for the noise pass; one fragment per terrain grid vertex
+
+in vec2 aPos;
+
+void main() {
+    gl_Position = vec4(aPos, 0.0, 1.0);
+}
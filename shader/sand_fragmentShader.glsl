@@ -14,6 +14,10 @@ uniform sampler2D texture2; // Texture for sandy areas
 uniform float waterLevel;    // Height at which water starts
 uniform bool useWaterTexture; // Flag indicating whether to use water texture
 
+// Terrain heights for the water pass, which draws a flat quad and looks up the ground below it
+uniform sampler2D heightMap;
+uniform vec4 heightMapTransform; // TexCoord * xy + zw gives the height map coordinates
+
 // Lighting parameters
 uniform vec3 ambientLight; // Ambient light color and intensity
 uniform vec3 lightPos;     // Position of the light source
@@ -26,13 +30,18 @@ uniform float HeightDif_high;
 uniform float waterDepthMax;
 
 void main() {
+    float terrainHeight = TerrainHeight;
+    if (useWaterTexture) {
+        terrainHeight = texture2D(heightMap, TexCoord * heightMapTransform.xy + heightMapTransform.zw).r;
+    }
+
     // Sample textures based on texture coordinates
     vec4 color1 = texture2D(texture1, TexCoord); // Grassland texture
     vec4 color2 = texture2D(texture2, TexCoord); // Sandy area texture
 
     // Determine terrain color based on height
     vec4 terrainColor;
-    float factor = clamp((TerrainHeight - HeightDif_low) / HeightDif_high, 0.0, 1.0);
+    float factor = clamp((terrainHeight - HeightDif_low) / HeightDif_high, 0.0, 1.0);
     terrainColor = mix(color2, color1, factor);
 
     // Calculate ambient light contribution
@@ -51,9 +60,9 @@ void main() {
     // Apply water surface texture effect if enabled
     if (useWaterTexture) {
         // Check if current fragment is below water level
-        if (TerrainHeight < waterLevel) {
+        if (terrainHeight < waterLevel) {
             // Calculate depth factor for transparency
-            float depthFactor = (waterLevel - TerrainHeight) / waterDepthMax;
+            float depthFactor = (waterLevel - terrainHeight) / waterDepthMax;
             float alpha = clamp(depthFactor + 0.2, 0.2, 0.8); // Adjust alpha for transparency effect
 
             // Water color with ambient and diffuse lighting
@@ -1,7 +1,22 @@
 #version 120
+#extension GL_ARB_uniform_buffer_object : enable
 
 // Vertex shader for terrain rendering
 
+// Per-frame matrices (FrameData in RenderState.hpp): a uniform block shared by all programs where
+// uniform buffers are supported, plain uniforms otherwise
+#ifdef GL_ARB_uniform_buffer_object
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
+#else
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat4 viewProjection;
+#endif
+
 // Input attributes
 attribute vec3 aPos;        // Vertex position
 attribute vec3 aNormal;     // Vertex normal
@@ -16,12 +31,12 @@ varying vec3 FragPos;       // Vertex position in world space to pass to fragmen
 
 void main() {
     // Calculate vertex position in clip space
-    gl_Position = gl_ModelViewProjectionMatrix * vec4(aPos, 1.0);
+    gl_Position = viewProjection * vec4(aPos, 1.0);
 
     // Pass varying values to fragment shader
     TexCoord = aTexCoord;       // Pass texture coordinates
     TerrainHeight = aHeight;    // Pass terrain height
     FragNormal = aNormal;       // Pass vertex normal
-    FragPos = vec3(gl_ModelViewMatrix * vec4(aPos, 1.0)); // Calculate and pass vertex position in world space
+    FragPos = vec3(view * vec4(aPos, 1.0)); // Calculate and pass vertex position in world space
 }
 
@@ -0,0 +1,65 @@
+#version 120
+#extension GL_ARB_uniform_buffer_object : enable
+
+// Vertex shader for terrain rendering with the compact vertex format (--compact-vertices).
+// Position and texture coordinates are rebuilt from the grid position, the height is unpacked
+// from 16 bits and the normal from its octahedral encoding. Feeds the same fragment shader.
+
+// Per-frame matrices, declared as in sand_vertexShader.glsl
+#ifdef GL_ARB_uniform_buffer_object
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
+#else
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat4 viewProjection;
+#endif
+
+// Input attributes
+attribute vec2 aGrid;       // Grid column and row
+attribute float aHeight;    // Terrain height, normalized to heightRange
+attribute vec2 aNormal;     // Octahedral-encoded normal
+
+// Grid layout, set once after upload
+uniform vec2 gridOrigin;    // World x/z of column 0 and row 0
+uniform float gridSpacing;  // World distance between neighbouring columns/rows
+uniform vec2 gridSize;      // Number of columns and rows
+uniform vec2 heightRange;   // World heights for aHeight = 0 and aHeight = 1
+
+// Water parameters; the water quad is flattened to the water level
+uniform float waterLevel;
+uniform bool useWaterTexture;
+
+// Output varyings
+varying vec2 TexCoord;      // Texture coordinates for fragment shader
+varying float TerrainHeight; // Terrain height to pass to fragment shader
+varying vec3 FragNormal;    // Normal vector to pass to fragment shader
+varying vec3 FragPos;       // Vertex position in world space to pass to fragment shader
+
+// Unfold an octahedral-encoded normal (around +y)
+vec3 decodeNormal(vec2 encoded) {
+    vec3 normal = vec3(encoded.x, 1.0 - abs(encoded.x) - abs(encoded.y), encoded.y);
+    if (normal.y < 0.0) {
+        normal.xz = (1.0 - abs(normal.zx)) * sign(normal.xz);
+    }
+    return normalize(normal);
+}
+
+void main() {
+    float terrainHeight = mix(heightRange.x, heightRange.y, aHeight);
+    vec3 position = vec3(gridOrigin.x + aGrid.x * gridSpacing,
+                         useWaterTexture ? waterLevel : terrainHeight,
+                         gridOrigin.y + aGrid.y * gridSpacing);
+
+    // Calculate vertex position in clip space
+    gl_Position = viewProjection * vec4(position, 1.0);
+
+    // Pass varying values to fragment shader
+    TexCoord = aGrid / gridSize;
+    TerrainHeight = terrainHeight;
+    FragNormal = useWaterTexture ? vec3(0.0, 1.0, 0.0) : decodeNormal(aNormal);
+    FragPos = vec3(view * vec4(position, 1.0));
+}
@@ -0,0 +1,33 @@
+// Replaces the global operator new/delete so every heap allocation is counted by
+// Profiler::recordAllocation. Only linked into terrain_bench and, with
+// -DTERRAIN_COUNT_ALLOCATIONS=ON, terrain_generator; other builds allocate without the atomic add.
+#include <cstdlib>
+#include <new>
+#include "Profiler.hpp"
+
+void* operator new(std::size_t size) {
+    Profiler::recordAllocation(size);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+// Every delete form frees through the unsized one, which is the only caller of std::free
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    ::operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    ::operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    ::operator delete(ptr);
+}
@@ -0,0 +1,225 @@
+#include "ChunkManager.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "Profiler.hpp"
+#include "TerrainGenerate.hpp"
+#include "shader.hpp"
+
+namespace {
+
+// Uploading is done on the render thread, so only a few chunks per frame to keep frame times flat
+const int maxUploadsPerFrame = 2;
+
+} // namespace
+
+ChunkManager::ChunkManager(std::shared_ptr<const ChunkGenerator> generator_, ThreadPool& pool_, GLuint shaderProgram_, int viewRadius_)
+    : generator(std::move(generator_)), pool(pool_), shaderProgram(shaderProgram_), viewRadius(viewRadius_),
+      finished(std::make_shared<FinishedQueue>()), frame(0) {
+    heightMapTransformLoc = glGetUniformLocation(shaderProgram, "heightMapTransform");
+}
+
+ChunkManager::~ChunkManager() {
+    for (auto& [key, chunk] : chunks) {
+        destroyChunk(chunk);
+    }
+}
+
+size_t ChunkManager::getResidentCount() const {
+    return chunks.size();
+}
+
+size_t ChunkManager::getPendingCount() const {
+    return pending.size();
+}
+
+unsigned long long ChunkManager::getDrawnTriangleCount() const {
+    unsigned long long triangles = 0;
+    for (const Chunk* chunk : visibleChunks) {
+        triangles += chunk->triangleCount;
+    }
+    return triangles;
+}
+
+bool ChunkManager::inRadius(const ChunkKey& key, int centerX, int centerZ, int radius) const {
+    return std::abs(key.first - centerX) <= radius && std::abs(key.second - centerZ) <= radius;
+}
+
+// Stream chunks for the current camera position and pick the visible ones; call once per frame before drawing
+void ChunkManager::update(const Vec& cameraPos, const Frustum& frustum) {
+    ++frame;
+    const float chunkSize = generator->getChunkWorldSize();
+    const int centerX = static_cast<int>(std::floor(cameraPos.x / chunkSize));
+    const int centerZ = static_cast<int>(std::floor(cameraPos.z / chunkSize));
+
+    uploadFinished(centerX, centerZ);
+
+    for (auto& [key, chunk] : chunks) {
+        if (inRadius(key, centerX, centerZ, viewRadius)) chunk.lastUsed = frame;
+    }
+
+    requestChunks(centerX, centerZ);
+    evictChunks(centerX, centerZ);
+    cullChunks(frustum);
+}
+
+void ChunkManager::cullChunks(const Frustum& frustum) {
+    ScopedTimer timer("chunk_cull");
+    visibleChunks.clear();
+    for (const auto& [key, chunk] : chunks) {
+        if (testBoxInFrustum(frustum, chunk.boundsMin, chunk.boundsMax) != FrustumTest::Outside) {
+            visibleChunks.push_back(&chunk);
+        }
+    }
+    timer.addCounter("chunks_drawn", static_cast<long long>(visibleChunks.size()));
+    timer.addCounter("chunks_culled", static_cast<long long>(chunks.size() - visibleChunks.size()));
+}
+
+// Queue generation of the missing chunks in the view radius, nearest first
+void ChunkManager::requestChunks(int centerX, int centerZ) {
+    const size_t maxPending = pool.getThreadCount() * 2;
+    if (pending.size() >= maxPending) return;
+
+    std::vector<ChunkKey> missing;
+    for (int z = centerZ - viewRadius; z <= centerZ + viewRadius; ++z) {
+        for (int x = centerX - viewRadius; x <= centerX + viewRadius; ++x) {
+            ChunkKey key{x, z};
+            if (!chunks.count(key) && !pending.count(key)) missing.push_back(key);
+        }
+    }
+    std::sort(missing.begin(), missing.end(), [&](const ChunkKey& a, const ChunkKey& b) {
+        auto distance = [&](const ChunkKey& k) {
+            return (k.first - centerX) * (k.first - centerX) + (k.second - centerZ) * (k.second - centerZ);
+        };
+        return distance(a) < distance(b);
+    });
+
+    for (const ChunkKey& key : missing) {
+        if (pending.size() >= maxPending) break;
+        pending.insert(key);
+        std::shared_ptr<const ChunkGenerator> generatorRef = generator;
+        std::shared_ptr<FinishedQueue> queue = finished;
+        pool.submit([generatorRef, queue, key] {
+            ChunkMesh mesh = generatorRef->generateChunk(key.first, key.second);
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->meshes.push_back(std::move(mesh));
+        });
+    }
+}
+
+// Upload a few finished chunks; ones the camera has already left behind are dropped
+void ChunkManager::uploadFinished(int centerX, int centerZ) {
+    std::vector<ChunkMesh> ready;
+    {
+        std::lock_guard<std::mutex> lock(finished->mutex);
+        size_t count = std::min(finished->meshes.size(), static_cast<size_t>(maxUploadsPerFrame));
+        std::move(finished->meshes.begin(), finished->meshes.begin() + count, std::back_inserter(ready));
+        finished->meshes.erase(finished->meshes.begin(), finished->meshes.begin() + count);
+    }
+    if (ready.empty()) return;
+
+    ScopedTimer timer("chunk_upload");
+    for (const ChunkMesh& mesh : ready) {
+        ChunkKey key{mesh.chunkX, mesh.chunkZ};
+        pending.erase(key);
+        if (!inRadius(key, centerX, centerZ, viewRadius + 1)) continue;
+        uploadChunk(mesh);
+        timer.addCounter("chunks", 1);
+        timer.addCounter("vertices", static_cast<long long>(mesh.vertices.size() / 9));
+    }
+}
+
+void ChunkManager::uploadChunk(const ChunkMesh& mesh) {
+    Chunk& chunk = chunks[{mesh.chunkX, mesh.chunkZ}];
+    chunk.indexCount = static_cast<GLsizei>(mesh.indices.size());
+    // Two triangles per grid cell, whether indexed as lists or strips
+    chunk.triangleCount = 2ull * (mesh.columns - 1) * (mesh.columns - 1);
+    chunk.waterFirstVertex = static_cast<GLint>(mesh.waterFirstVertex);
+    chunk.lastUsed = frame;
+    const float chunkSize = generator->getChunkWorldSize();
+    const float waterLevel = generator->getSettings().waterLevel;
+    chunk.boundsMin = {mesh.chunkX * chunkSize, std::min(mesh.minHeight, waterLevel), mesh.chunkZ * chunkSize};
+    chunk.boundsMax = {(mesh.chunkX + 1) * chunkSize, std::max(mesh.maxHeight, waterLevel), (mesh.chunkZ + 1) * chunkSize};
+
+    GL_CHECK(glGenVertexArrays(1, &chunk.VAO));
+    GL_CHECK(glBindVertexArray(chunk.VAO));
+
+    GL_CHECK(glGenBuffers(1, &chunk.VBO));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, chunk.VBO));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(GLfloat), mesh.vertices.data(), GL_STATIC_DRAW));
+
+    GL_CHECK(glGenBuffers(1, &chunk.EBO));
+    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.EBO));
+    GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLushort), mesh.indices.data(), GL_STATIC_DRAW));
+
+    setupTerrainVertexAttributes(shaderProgram);
+    GL_CHECK(glBindVertexArray(0));
+
+    // TexCoord is world based, (x + width / 2) / width; map it to texel centres of this chunk's grid
+    const WorldSettings& settings = generator->getSettings();
+    const float originX = static_cast<float>(mesh.chunkX * settings.chunkCells * settings.step);
+    const float originZ = static_cast<float>(mesh.chunkZ * settings.chunkCells * settings.step);
+    const float texelsPerUnit = static_cast<float>(settings.width) / (settings.step * mesh.columns);
+    chunk.heightTexture = createHeightTexture(mesh.heights.data(), mesh.columns, mesh.columns);
+    chunk.heightMapTransform[0] = texelsPerUnit;
+    chunk.heightMapTransform[1] = texelsPerUnit;
+    chunk.heightMapTransform[2] = ((-settings.width / 2 - originX) / settings.step + 0.5f) / mesh.columns;
+    chunk.heightMapTransform[3] = ((-settings.width / 2 - originZ) / settings.step + 0.5f) / mesh.columns;
+}
+
+// Keep at most one ring of chunks beyond the view radius; drop the least recently used ones past that
+void ChunkManager::evictChunks(int centerX, int centerZ) {
+    const size_t budget = static_cast<size_t>((2 * viewRadius + 3) * (2 * viewRadius + 3));
+    if (chunks.size() <= budget) return;
+
+    std::vector<std::pair<unsigned long long, ChunkKey>> candidates;
+    for (const auto& [key, chunk] : chunks) {
+        if (!inRadius(key, centerX, centerZ, viewRadius)) candidates.push_back({chunk.lastUsed, key});
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto& candidate : candidates) {
+        if (chunks.size() <= budget) break;
+        auto it = chunks.find(candidate.second);
+        destroyChunk(it->second);
+        chunks.erase(it);
+    }
+}
+
+void ChunkManager::destroyChunk(Chunk& chunk) {
+    if (chunk.VAO == 0) return;
+    glDeleteBuffers(1, &chunk.VBO);
+    glDeleteBuffers(1, &chunk.EBO);
+    glDeleteVertexArrays(1, &chunk.VAO);
+    glDeleteTextures(1, &chunk.heightTexture);
+    chunk.VAO = chunk.VBO = chunk.EBO = chunk.heightTexture = 0;
+}
+
+void ChunkManager::drawTerrain() const {
+    const bool strips = generator->getSettings().triangleStrips;
+    if (strips) {
+        GL_CHECK(glEnable(GL_PRIMITIVE_RESTART));
+        GL_CHECK(glPrimitiveRestartIndex(chunkRestartIndex));
+    }
+    for (const Chunk* chunk : visibleChunks) {
+        GL_CHECK(glBindVertexArray(chunk->VAO));
+        GL_CHECK(glDrawElements(strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES, chunk->indexCount, GL_UNSIGNED_SHORT, 0));
+    }
+    GL_CHECK(glBindVertexArray(0));
+    if (strips) {
+        GL_CHECK(glDisable(GL_PRIMITIVE_RESTART));
+    }
+}
+
+// One quad per chunk; the fragment shader reads the ground height from the chunk's height map
+void ChunkManager::drawWater() const {
+    GL_CHECK(glActiveTexture(GL_TEXTURE0 + heightMapTextureUnit));
+    for (const Chunk* chunk : visibleChunks) {
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, chunk->heightTexture));
+        GL_CHECK(glUniform4fv(heightMapTransformLoc, 1, chunk->heightMapTransform));
+        GL_CHECK(glBindVertexArray(chunk->VAO));
+        GL_CHECK(glDrawArrays(GL_TRIANGLE_FAN, chunk->waterFirstVertex, 4));
+    }
+    GL_CHECK(glBindVertexArray(0));
+    GL_CHECK(glActiveTexture(GL_TEXTURE0));
+}
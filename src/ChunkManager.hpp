@@ -0,0 +1,76 @@
+#ifndef CHUNK_MANAGER_HPP
+#define CHUNK_MANAGER_HPP
+
+#include <GL/glew.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+#include "TerrainChunk.hpp"
+#include "ThreadPool.hpp"
+#include "math.hpp"
+
+// Streams the chunks of an unbounded terrain around the camera. Missing chunks within the view
+// radius are generated on the thread pool, a few finished ones are uploaded each frame, and
+// chunks outside the radius are evicted least recently used first once over the memory budget.
+// Only the chunks inside the view frustum are drawn.
+class ChunkManager {
+public:
+    ChunkManager(std::shared_ptr<const ChunkGenerator> generator, ThreadPool& pool, GLuint shaderProgram, int viewRadius);
+    ~ChunkManager();
+
+    ChunkManager(const ChunkManager&) = delete;
+    ChunkManager& operator=(const ChunkManager&) = delete;
+
+    void update(const Vec& cameraPos, const Frustum& frustum);
+    void drawTerrain() const;
+    void drawWater() const;
+
+    size_t getResidentCount() const;
+    size_t getPendingCount() const;
+    unsigned long long getDrawnTriangleCount() const; // Terrain triangles of the chunks drawTerrain draws
+
+private:
+    using ChunkKey = std::pair<int, int>;
+
+    struct Chunk {
+        GLuint VAO = 0, VBO = 0, EBO = 0;
+        GLuint heightTexture = 0;          // Terrain heights for the water pass
+        GLfloat heightMapTransform[4] = {}; // Maps TexCoord to texel centres of heightTexture
+        GLsizei indexCount = 0;
+        unsigned long long triangleCount = 0;
+        GLint waterFirstVertex = 0;
+        unsigned long long lastUsed = 0; // Last frame the chunk was inside the view radius
+        Vec boundsMin, boundsMax;         // Terrain and water of the chunk
+    };
+
+    // Meshes handed back by the workers. Shared with the tasks, so a task finishing
+    // after the manager is gone never touches freed memory.
+    struct FinishedQueue {
+        std::mutex mutex;
+        std::vector<ChunkMesh> meshes;
+    };
+
+    void uploadFinished(int centerX, int centerZ);
+    void requestChunks(int centerX, int centerZ);
+    void evictChunks(int centerX, int centerZ);
+    void cullChunks(const Frustum& frustum);
+    void uploadChunk(const ChunkMesh& mesh);
+    void destroyChunk(Chunk& chunk);
+    bool inRadius(const ChunkKey& key, int centerX, int centerZ, int radius) const;
+
+    std::shared_ptr<const ChunkGenerator> generator;
+    ThreadPool& pool;
+    GLuint shaderProgram;
+    GLint heightMapTransformLoc;
+    int viewRadius;
+    std::map<ChunkKey, Chunk> chunks;
+    std::set<ChunkKey> pending;
+    std::vector<const Chunk*> visibleChunks; // Chunks to draw this frame, refreshed by update
+    std::shared_ptr<FinishedQueue> finished;
+    unsigned long long frame;
+};
+
+#endif // CHUNK_MANAGER_HPP
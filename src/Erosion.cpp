@@ -0,0 +1,232 @@
+#include "Erosion.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Profiler.hpp"
+
+namespace {
+
+// A band of fewer cells costs more to hand to a worker than to run
+const int minBandCells = 32 * 32;
+// Less water than this counts as none; keeps the divisions branch-free, so the loops vectorize
+const float minWater = 1e-6f;
+
+// Jitter in [0.5, 1.5) for the rain on one cell, hashed from the seed, so every seed gets its own streams
+float rainJitter(uint32_t seed, uint32_t cell) {
+    uint32_t hash = seed ^ (cell * 0x9e3779b9u);
+    hash ^= hash >> 16;
+    hash *= 0x7feb352du;
+    hash ^= hash >> 15;
+    hash *= 0x846ca68bu;
+    hash ^= hash >> 16;
+    return 0.5f + static_cast<float>(hash >> 8) * (1.0f / 16777216.0f);
+}
+
+// The row kernels below run over the columns of one row. Their pointers point at the row's first
+// cell in a padded grid of stride floats per row, so [i - stride] and [i + stride] are the rows above
+// and below. Every grid is a separate buffer, which __restrict tells the vectorizer.
+
+// Push water towards every lower neighbour (by surface height) through its pipe, on top of the flow
+// of the last iteration. A cell never sends more water than it holds.
+void updateOutflow(const float* __restrict ground, const float* __restrict water,
+                   const float* __restrict left, const float* __restrict right, const float* __restrict up, const float* __restrict down,
+                   float* __restrict newLeft, float* __restrict newRight, float* __restrict newUp, float* __restrict newDown,
+                   int columns, ptrdiff_t stride, float flow) {
+    for (int i = 0; i < columns; ++i) {
+        const float depth = water[i];
+        const float level = ground[i] + depth;
+        const float toLeft = std::max(0.0f, left[i] + flow * (level - ground[i - 1] - water[i - 1]));
+        const float toRight = std::max(0.0f, right[i] + flow * (level - ground[i + 1] - water[i + 1]));
+        const float toUp = std::max(0.0f, up[i] + flow * (level - ground[i - stride] - water[i - stride]));
+        const float toDown = std::max(0.0f, down[i] + flow * (level - ground[i + stride] - water[i + stride]));
+        const float total = toLeft + toRight + toUp + toDown;
+        const float scale = depth / std::max(std::max(total, depth), minWater); // 1 unless it sends too much
+        newLeft[i] = toLeft * scale;
+        newRight[i] = toRight * scale;
+        newUp[i] = toUp * scale;
+        newDown[i] = toDown * scale;
+    }
+}
+
+// Sediment that lands on each cell: what stayed behind plus what the last iteration's flows brought in
+void transportSediment(const float* __restrict kept, const float* __restrict concentration,
+                       const float* __restrict left, const float* __restrict right, const float* __restrict up, const float* __restrict down,
+                       float* __restrict carried, int columns, ptrdiff_t stride) {
+    for (int i = 0; i < columns; ++i) {
+        carried[i] = kept[i] + concentration[i - 1] * right[i - 1] + concentration[i + 1] * left[i + 1] +
+                     concentration[i - stride] * down[i - stride] + concentration[i + stride] * up[i + stride];
+    }
+}
+
+struct SedimentRates {
+    float capacity, dissolving, deposition, minSlope; // minSlope as the squared sine of its angle
+};
+
+// One row of an iteration after updateOutflow and transportSediment:
+// - this iteration's flows (newLeft..newDown in the row, downAbove/upBelow from the rows next to it)
+//   move the water, which then evaporates and gets the rain of the next iteration,
+// - sediment is dissolved or deposited until the water carries what the slope and the discharge
+//   through the cell allow; the sediment per unit of water and what stays behind go to the next iteration.
+void erodeRow(const float* __restrict ground, const float* __restrict water, const float* __restrict rain,
+              const float* __restrict carriedIn,
+              const float* __restrict newLeft, const float* __restrict newRight, const float* __restrict newUp, const float* __restrict newDown,
+              const float* __restrict downAbove, const float* __restrict upBelow,
+              float* __restrict nextWater, float* __restrict eroded, float* __restrict nextConcentration, float* __restrict nextKept,
+              int columns, ptrdiff_t stride, float keep, SedimentRates rates) {
+    for (int i = 0; i < columns; ++i) {
+        const float carried = carriedIn[i];
+
+        const float before = water[i];
+        const float fromLeft = newRight[i - 1], fromRight = newLeft[i + 1];
+        const float fromUp = downAbove[i], fromDown = upBelow[i];
+        const float sent = newLeft[i] + newRight[i] + newUp[i] + newDown[i];
+        nextWater[i] = std::max(0.0f, before + fromLeft + fromRight + fromUp + fromDown - sent) * keep + rain[i];
+
+        // Squared sine of the slope angle, and the squared discharge
+        const float gradientX = 0.5f * (ground[i + 1] - ground[i - 1]);
+        const float gradientY = 0.5f * (ground[i + stride] - ground[i - stride]);
+        const float gradient = gradientX * gradientX + gradientY * gradientY;
+        const float slope = std::max(rates.minSlope, gradient / (1.0f + gradient));
+        const float dischargeX = 0.5f * (fromLeft - newLeft[i] + newRight[i] - fromRight);
+        const float dischargeY = 0.5f * (fromUp - newUp[i] + newDown[i] - fromDown);
+        const float capacity = rates.capacity * std::sqrt(slope * (dischargeX * dischargeX + dischargeY * dischargeY));
+
+        // Never dig below, or fill above, halfway to the lowest or highest neighbour in one iteration;
+        // otherwise a pit draws more water, which digs it deeper
+        const float lowest = std::min(std::min(ground[i - 1], ground[i + 1]), std::min(ground[i - stride], ground[i + stride]));
+        const float highest = std::max(std::max(ground[i - 1], ground[i + 1]), std::max(ground[i - stride], ground[i + stride]));
+        const float missing = capacity - carried;
+        const float change = std::clamp((missing > 0.0f ? rates.dissolving : rates.deposition) * missing,
+                                        std::min(0.0f, 0.5f * (ground[i] - highest)), std::max(0.0f, 0.5f * (ground[i] - lowest)));
+        eroded[i] = ground[i] - change;
+        const float suspended = carried + change;
+        const float perWater = suspended / std::max(before, minWater);
+        nextConcentration[i] = perWater;
+        nextKept[i] = suspended - perWater * sent;
+    }
+}
+
+} // namespace
+
+// The grids carry a one-cell border, so the kernels read neighbours without edge checks and vectorize.
+// Border cells keep the height of the edge next to them and never hold water or sediment: water that
+// flows onto them leaves the map, as rivers do at the edges.
+// Each iteration is a single pass over row bands, one per thread. A row needs this iteration's flows
+// of the rows above and below, so a band also computes them for the two rows next to it, which the
+// neighbouring bands own, instead of waiting for them. Everything else is read from the last
+// iteration's buffers, so the bands never wait for each other and any split gives the same heights.
+void erodeHeightField(float* heights, int columns, int rows, float cellSize, const ErosionSettings& settings, int seed, ThreadPool* pool) {
+    if (settings.iterations <= 0 || columns < 2 || rows < 2) return;
+    ScopedTimer timer("erosion");
+    const ptrdiff_t stride = static_cast<ptrdiff_t>(columns) + 2;
+    const size_t padded = static_cast<size_t>(stride) * (rows + 2);
+    auto cell = [stride](int row, int column) { return static_cast<size_t>((row + 1) * stride + column + 1); };
+
+    // Water is what a cell holds at the start of an iteration, after evaporation and rain
+    std::vector<float> terrain(padded), erodedTerrain(padded), rainfall(padded, 0.0f);
+    std::vector<float> water(padded, 0.0f), nextWater(padded, 0.0f);
+    std::vector<float> concentration(padded, 0.0f), nextConcentration(padded, 0.0f);
+    std::vector<float> keptSediment(padded, 0.0f), nextKeptSediment(padded, 0.0f);
+    // Water sent to each neighbour in the last iteration and in this one
+    std::vector<float> outLeft(padded, 0.0f), outRight(padded, 0.0f), outUp(padded, 0.0f), outDown(padded, 0.0f);
+    std::vector<float> nextLeft(padded, 0.0f), nextRight(padded, 0.0f), nextUp(padded, 0.0f), nextDown(padded, 0.0f);
+
+    // Heights in cells, so the settings do not depend on the grid spacing
+    const float toCells = 1.0f / cellSize;
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            const size_t i = cell(row, column);
+            terrain[i] = heights[static_cast<size_t>(row) * columns + column] * toCells;
+            rainfall[i] = settings.rain * rainJitter(static_cast<uint32_t>(seed), static_cast<uint32_t>(row * columns + column));
+            water[i] = rainfall[i];
+        }
+    }
+    auto copyBorder = [&](std::vector<float>& grid) {
+        for (int column = 0; column < columns; ++column) {
+            grid[cell(-1, column)] = grid[cell(0, column)];
+            grid[cell(rows, column)] = grid[cell(rows - 1, column)];
+        }
+        for (int row = -1; row <= rows; ++row) {
+            grid[cell(row, -1)] = grid[cell(row, 0)];
+            grid[cell(row, columns)] = grid[cell(row, columns - 1)];
+        }
+    };
+    copyBorder(terrain);
+
+    const long long cells = static_cast<long long>(columns) * rows;
+    const int bandCount = pool ? static_cast<int>(std::clamp<long long>(cells / minBandCells, 1, pool->getThreadCount())) : 1;
+    // Per band, the four flows of the row above it and of the row below it
+    std::vector<float> haloFlows(static_cast<size_t>(bandCount) * 8 * columns);
+    std::vector<float> carriedRows(static_cast<size_t>(bandCount) * columns);
+
+    const float keep = 1.0f - settings.evaporation;
+    const SedimentRates rates = {settings.capacity, settings.dissolving, settings.deposition,
+                                 settings.minSlope * settings.minSlope / (1.0f + settings.minSlope * settings.minSlope)};
+    auto erodeBand = [&](int band) {
+        const int rowBegin = static_cast<int>(static_cast<long long>(rows) * band / bandCount);
+        const int rowEnd = static_cast<int>(static_cast<long long>(rows) * (band + 1) / bandCount);
+        auto outflow = [&](int row, float* toLeft, float* toRight, float* toUp, float* toDown) {
+            const size_t i = cell(row, 0);
+            updateOutflow(&terrain[i], &water[i], &outLeft[i], &outRight[i], &outUp[i], &outDown[i],
+                          toLeft, toRight, toUp, toDown, columns, stride, settings.flow);
+        };
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            const size_t i = cell(row, 0);
+            outflow(row, &nextLeft[i], &nextRight[i], &nextUp[i], &nextDown[i]);
+        }
+        // Outside the grid the flows stay 0
+        float* above = &haloFlows[static_cast<size_t>(band) * 8 * columns];
+        float* below = above + 4 * columns;
+        float* carriedRow = &carriedRows[static_cast<size_t>(band) * columns];
+        const float* downAbove = &nextDown[cell(rowBegin - 1, 0)];
+        const float* upBelow = &nextUp[cell(rowEnd, 0)];
+        if (rowBegin > 0) {
+            outflow(rowBegin - 1, above, above + columns, above + 2 * columns, above + 3 * columns);
+            downAbove = above + 3 * columns;
+        }
+        if (rowEnd < rows) {
+            outflow(rowEnd, below, below + columns, below + 2 * columns, below + 3 * columns);
+            upBelow = below + 2 * columns;
+        }
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            const size_t i = cell(row, 0);
+            transportSediment(&keptSediment[i], &concentration[i], &outLeft[i], &outRight[i], &outUp[i], &outDown[i], carriedRow, columns, stride);
+            erodeRow(&terrain[i], &water[i], &rainfall[i], carriedRow, &nextLeft[i], &nextRight[i], &nextUp[i], &nextDown[i],
+                     row == rowBegin ? downAbove : &nextDown[cell(row - 1, 0)], row == rowEnd - 1 ? upBelow : &nextUp[cell(row + 1, 0)],
+                     &nextWater[i], &erodedTerrain[i], &nextConcentration[i], &nextKeptSediment[i], columns, stride, keep, rates);
+        }
+    };
+
+    for (int iteration = 0; iteration < settings.iterations; ++iteration) {
+        if (bandCount > 1) {
+            pool->parallelFor(0, bandCount, [&](int first, int last) {
+                for (int band = first; band < last; ++band) erodeBand(band);
+            });
+        } else {
+            erodeBand(0);
+        }
+        terrain.swap(erodedTerrain);
+        copyBorder(terrain);
+        water.swap(nextWater);
+        concentration.swap(nextConcentration);
+        keptSediment.swap(nextKeptSediment);
+        outLeft.swap(nextLeft);
+        outRight.swap(nextRight);
+        outUp.swap(nextUp);
+        outDown.swap(nextDown);
+    }
+
+    // Whatever the water still carries settles where the last flows took it
+    float* settled = carriedRows.data();
+    for (int row = 0; row < rows; ++row) {
+        const size_t i = cell(row, 0);
+        transportSediment(&keptSediment[i], &concentration[i], &outLeft[i], &outRight[i], &outUp[i], &outDown[i], settled, columns, stride);
+        for (int column = 0; column < columns; ++column) {
+            heights[static_cast<size_t>(row) * columns + column] = (terrain[i + column] + settled[column]) * cellSize;
+        }
+    }
+    timer.addCounter("iterations", settings.iterations);
+    timer.addCounter("vertices", cells);
+}
@@ -0,0 +1,27 @@
+#ifndef EROSION_HPP
+#define EROSION_HPP
+
+#include "ThreadPool.hpp"
+
+// Parameters of erodeHeightField. Lengths and heights are in grid cells, so the same settings carve
+// similar valleys at every --width/--lod.
+struct ErosionSettings {
+    int iterations = 0;         // 0 turns erosion off
+    float rain = 0.02f;         // Water added to every cell per iteration (jittered per cell by the seed)
+    float flow = 0.5f;          // How fast a height difference drives water through the pipe between two cells
+    float evaporation = 0.03f;  // Fraction of the water that evaporates per iteration
+    float capacity = 4.0f;      // Sediment a unit of water carries per unit of discharge and slope
+    float dissolving = 0.5f;    // Fraction of the missing capacity picked up from the ground per iteration
+    float deposition = 0.5f;    // Fraction of the excess sediment dropped per iteration
+    float minSlope = 0.05f;     // Keeps some capacity on flat ground, so lakes still fill in
+};
+
+// Grid-based hydraulic erosion (virtual pipe model) of a columns x rows heightfield, row by row, with
+// cellSize between neighbouring vertices in the units of the heights. Every iteration rains on the
+// grid, moves water along the height differences, dissolves or deposits sediment depending on the
+// discharge and slope of the water, carries the sediment with it and lets some water evaporate.
+// Each iteration only writes its own buffers and reads the last iteration's, so the result depends on
+// the settings and seed but not on the pool or its thread count.
+void erodeHeightField(float* heights, int columns, int rows, float cellSize, const ErosionSettings& settings, int seed, ThreadPool* pool);
+
+#endif // EROSION_HPP
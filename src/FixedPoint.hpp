@@ -0,0 +1,53 @@
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <cstdint>
+
+// Q16.16 fixed-point number: 16 integer and 16 fraction bits in an int32_t, so values run from
+// -32768 to just below 32768 in steps of 1/65536. Products and quotients go through 64 bits; products
+// are truncated towards minus infinity and quotients towards zero, as int64_t division does. Used as
+// the Real of the PerlinNoise templates, e.g. noise<Fixed16, 2>, for targets without a fast FPU;
+// sample coordinates must stay within the range.
+struct Fixed16 {
+    static const int fractionBits = 16;
+    static const int32_t one = 1 << fractionBits;
+
+    int32_t raw = 0;
+
+    constexpr Fixed16() = default;
+    constexpr Fixed16(int value) : raw(static_cast<int32_t>(static_cast<uint32_t>(value) << fractionBits)) {}
+    constexpr explicit Fixed16(double value) : raw(static_cast<int32_t>(value * one)) {}
+    constexpr explicit Fixed16(float value) : raw(static_cast<int32_t>(value * one)) {}
+
+    static constexpr Fixed16 fromRaw(int32_t raw) {
+        Fixed16 result;
+        result.raw = raw;
+        return result;
+    }
+
+    constexpr explicit operator int() const { return raw >> fractionBits; } // Rounds towards minus infinity
+    constexpr explicit operator double() const { return static_cast<double>(raw) / one; }
+    constexpr explicit operator float() const { return static_cast<float>(raw) / one; }
+
+    friend constexpr Fixed16 operator+(Fixed16 a, Fixed16 b) { return fromRaw(a.raw + b.raw); }
+    friend constexpr Fixed16 operator-(Fixed16 a, Fixed16 b) { return fromRaw(a.raw - b.raw); }
+    friend constexpr Fixed16 operator-(Fixed16 a) { return fromRaw(-a.raw); }
+    friend constexpr Fixed16 operator*(Fixed16 a, Fixed16 b) {
+        return fromRaw(static_cast<int32_t>((static_cast<int64_t>(a.raw) * b.raw) >> fractionBits));
+    }
+    friend constexpr Fixed16 operator/(Fixed16 a, Fixed16 b) {
+        return fromRaw(static_cast<int32_t>(static_cast<int64_t>(a.raw) * one / b.raw));
+    }
+    Fixed16& operator+=(Fixed16 other) { return *this = *this + other; }
+    Fixed16& operator-=(Fixed16 other) { return *this = *this - other; }
+    Fixed16& operator*=(Fixed16 other) { return *this = *this * other; }
+    Fixed16& operator/=(Fixed16 other) { return *this = *this / other; }
+
+    friend constexpr bool operator==(Fixed16 a, Fixed16 b) { return a.raw == b.raw; }
+    friend constexpr bool operator<(Fixed16 a, Fixed16 b) { return a.raw < b.raw; }
+
+    // Found by argument-dependent lookup where the noise templates call floor on their Real
+    friend constexpr Fixed16 floor(Fixed16 value) { return fromRaw(value.raw & ~(one - 1)); }
+};
+
+#endif // FIXED_POINT_HPP
@@ -0,0 +1,84 @@
+#include "Flythrough.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+bool loadCameraPath(const std::string& path, std::vector<CameraPose>& poses) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open camera path " << path << '\n';
+        return false;
+    }
+    poses.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        std::istringstream fields(line);
+        CameraPose pose;
+        if (!(fields >> pose.position.x >> pose.position.y >> pose.position.z >> pose.yaw >> pose.pitch)) {
+            std::cerr << path << ":" << lineNumber << ": expected \"x y z yaw pitch\"" << '\n';
+            return false;
+        }
+        poses.push_back(pose);
+    }
+    if (poses.empty()) {
+        std::cerr << "Camera path " << path << " has no poses" << '\n';
+        return false;
+    }
+    return true;
+}
+
+void writeCameraPose(std::ostream& out, const CameraPose& pose) {
+    out << pose.position.x << ' ' << pose.position.y << ' ' << pose.position.z << ' '
+        << pose.yaw << ' ' << pose.pitch << '\n';
+}
+
+std::vector<CameraPose> generateCameraPath(int width, int frames) {
+    // Vertices are placed at x * 0.1 and the heights scale with width / 60 (see TerrainMesh)
+    const float halfExtent = width * 0.05f;
+    const float radius = halfExtent * 0.6f;
+    const float baseHeight = width / 25.0f;
+    std::vector<CameraPose> poses(frames);
+    for (int i = 0; i < frames; ++i) {
+        const float t = 2.0f * static_cast<float>(M_PI) * i / frames;
+        CameraPose& pose = poses[i];
+        pose.position = {radius * std::cos(t), baseHeight * (1.0f + 0.5f * std::sin(3.0f * t)), radius * std::sin(t)};
+        pose.yaw = t * 180.0f / static_cast<float>(M_PI) + 90.0f + 35.0f; // Along the orbit, turned towards the centre
+        pose.pitch = -20.0f - 10.0f * std::sin(3.0f * t);
+    }
+    return poses;
+}
+
+double FlythroughStats::percentile(double p) const {
+    if (frameMs.empty()) return 0.0;
+    std::vector<double> sorted(frameMs);
+    std::sort(sorted.begin(), sorted.end());
+    const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+void FlythroughStats::writeJson(std::ostream& out, const std::string& renderer, int width, int height) const {
+    const size_t frames = frameMs.size();
+    const double totalMs = std::accumulate(frameMs.begin(), frameMs.end(), 0.0);
+    const unsigned long long totalTriangles = std::accumulate(triangles.begin(), triangles.end(), 0ull);
+    const auto [minTriangles, maxTriangles] = std::minmax_element(triangles.begin(), triangles.end());
+    out << "{\n  \"renderer\": \"" << renderer << "\",\n"
+        << "  \"resolution\": [" << width << ", " << height << "],\n"
+        << "  \"frames\": " << frames << ",\n"
+        << "  \"frame_ms\": {\"mean\": " << (frames ? totalMs / frames : 0.0)
+        << ", \"p50\": " << percentile(50) << ", \"p95\": " << percentile(95) << ", \"p99\": " << percentile(99)
+        << ", \"min\": " << percentile(0) << ", \"max\": " << percentile(100) << "},\n"
+        << "  \"triangles\": {\"mean\": " << (frames ? totalTriangles / frames : 0)
+        << ", \"min\": " << (frames ? *minTriangles : 0) << ", \"max\": " << (frames ? *maxTriangles : 0) << "},\n"
+        << "  \"per_frame\": [";
+    for (size_t i = 0; i < frames; ++i) {
+        out << (i == 0 ? "\n" : ",\n") << "    {\"ms\": " << frameMs[i] << ", \"triangles\": " << triangles[i] << "}";
+    }
+    out << "\n  ]\n}\n";
+}
@@ -0,0 +1,33 @@
+#ifndef FLYTHROUGH_HPP
+#define FLYTHROUGH_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "math.hpp"
+
+// One camera position per frame, as Camera::setPose takes it
+struct CameraPose {
+    Vec position;
+    float yaw, pitch; // Degrees
+};
+
+// Camera path files hold one pose per line, "x y z yaw pitch"; '#' starts a comment.
+// --record-camera writes them, --bench-flythrough replays them.
+bool loadCameraPath(const std::string& path, std::vector<CameraPose>& poses);
+void writeCameraPose(std::ostream& out, const CameraPose& pose);
+
+// A closed loop over a fixed-size terrain of the given TerrainMesh width: one orbit at a varying
+// height, looking ahead and down towards the centre, so near and far patches are both in view
+std::vector<CameraPose> generateCameraPath(int width, int frames);
+
+// Frame times and terrain triangles of a flythrough; percentiles use the nearest rank
+struct FlythroughStats {
+    std::vector<double> frameMs;
+    std::vector<unsigned long long> triangles;
+
+    double percentile(double p) const;
+    void writeJson(std::ostream& out, const std::string& renderer, int width, int height) const;
+};
+
+#endif // FLYTHROUGH_HPP
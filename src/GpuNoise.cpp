@@ -0,0 +1,208 @@
+#include "GpuNoise.hpp"
+#include <cmath>
+#include <iostream>
+#include "shader.hpp"
+#include "Profiler.hpp"
+
+GpuNoise::GpuNoise()
+    : program(0), VAO(0), VBO(0), framebuffer(0), heightTexture(0), permutationTexture(0),
+      latticeTextures{0, 0}, textureColumns(0), textureRows(0) {
+}
+
+GpuNoise::~GpuNoise() {
+    if (program == 0) return; // init never ran, so there may be no GL context
+    glDeleteProgram(program);
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &heightTexture);
+    glDeleteTextures(1, &permutationTexture);
+    glDeleteTextures(2, latticeTextures);
+}
+
+bool GpuNoise::init(ProgramCache& programCache) {
+    if (!GLEW_VERSION_3_0) {
+        std::cerr << "GPU noise needs OpenGL 3.0" << '\n';
+        return false;
+    }
+    program = programCache.createProgramFromFiles("shader/noise_vertexShader.glsl", "shader/noise_fragmentShader.glsl");
+    GLint linked = GL_FALSE;
+    if (program != 0) glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        std::cerr << "Failed to build the GPU noise shader" << '\n';
+        return false;
+    }
+
+    const GLfloat quad[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    GLint posAttrib = glGetAttribLocation(program, "aPos");
+    glEnableVertexAttribArray(posAttrib);
+    glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GLint boundTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+    glGenTextures(1, &permutationTexture);
+    glBindTexture(GL_TEXTURE_2D, permutationTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, 512, 1, 0, GL_RED, GL_FLOAT, nullptr);
+    glGenTextures(2, latticeTextures);
+    for (GLuint texture : latticeTextures) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glGenTextures(1, &heightTexture);
+    glBindTexture(GL_TEXTURE_2D, boundTexture);
+    glGenFramebuffers(1, &framebuffer);
+
+    // Check that an R32F texture can be rendered to before promising anything
+    resize(1, 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Float render targets are not supported, GPU noise is off" << '\n';
+        return false;
+    }
+    return true;
+}
+
+// (Re)allocate the height texture for a grid of the given size
+void GpuNoise::resize(int columns, int rows) {
+    if (columns == textureColumns && rows == textureRows) return;
+    GLint boundTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, columns, rows, 0, GL_RED, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_2D, boundTexture);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, heightTexture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    textureColumns = columns;
+    textureRows = rows;
+}
+
+namespace {
+
+// Lattice cell (mod 256) and fraction of coordinate * frequency for every grid line and octave, worked
+// out in double precision like PerlinNoise::noise does, so only the noise itself runs in single precision
+void fillLattice(std::vector<GLfloat>& lattice, int size, int step, double frequency, int octave, double lacunarity) {
+    lattice.resize(static_cast<size_t>(size / step) * octave * 2);
+    GLfloat* texel = lattice.data();
+    for (int i = 0; i < octave; ++i) {
+        for (int line = 0; line < size / step; ++line) {
+            // Same sample position as TerrainMesh::generateBaseTerrain
+            const double position = static_cast<float>(-size / 2 + line * step) / size * frequency;
+            const double cell = std::floor(position);
+            *texel++ = static_cast<GLfloat>(cell - 256.0 * std::floor(cell / 256.0));
+            *texel++ = static_cast<GLfloat>(position - cell);
+        }
+        frequency *= lacunarity;
+    }
+}
+
+} // namespace
+
+// One draw of a full-screen quad into the height texture, then a read back
+bool GpuNoise::generate(const PerlinNoise& noise, int width, int step, double frequency, int octave, double amplitude,
+                        double persistence, double lacunarity, std::vector<float>& heights) {
+    if (octave > maxOctaves) {
+        std::cerr << "GPU noise supports up to " << maxOctaves << " octaves" << '\n';
+        return false;
+    }
+    ScopedTimer timer("gpu_noise");
+    const int columns = width / step;
+    const int rows = width / step;
+    resize(columns, rows);
+
+    std::vector<GLfloat> latticeX, latticeZ;
+    fillLattice(latticeX, width, step, frequency, octave, lacunarity);
+    fillLattice(latticeZ, width, step, frequency, octave, lacunarity);
+    GLfloat octaveAmplitude[maxOctaves], octaveZFraction[maxOctaves];
+    GLint octaveZCell[maxOctaves];
+    double maxAmplitude = 0.0;
+    for (int i = 0; i < octave; ++i) {
+        octaveAmplitude[i] = static_cast<GLfloat>(amplitude);
+        const double z = 0.5 * frequency;
+        const double zCell = std::floor(z);
+        octaveZCell[i] = static_cast<GLint>(zCell - 256.0 * std::floor(zCell / 256.0));
+        octaveZFraction[i] = static_cast<GLfloat>(z - zCell);
+        maxAmplitude += amplitude;
+        frequency *= lacunarity;
+        amplitude *= persistence;
+    }
+    std::vector<GLfloat> permutation(noise.getPermutation().begin(), noise.getPermutation().end());
+
+    // Save the state the render loop relies on; the pass uses texture units 0 to 2
+    GLint viewport[4], boundTextures[3], boundFramebuffer = 0, currentProgram = 0, activeTexture = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &boundFramebuffer);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+    const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    for (int unit = 0; unit < 3; ++unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTextures[unit]);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, permutationTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, static_cast<GLsizei>(permutation.size()), 1, GL_RED, GL_FLOAT, permutation.data());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, latticeTextures[0]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, columns, octave, 0, GL_RG, GL_FLOAT, latticeX.data());
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, latticeTextures[1]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, rows, octave, 0, GL_RG, GL_FLOAT, latticeZ.data());
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "permutation"), 0);
+    glUniform1i(glGetUniformLocation(program, "latticeX"), 1);
+    glUniform1i(glGetUniformLocation(program, "latticeZ"), 2);
+    glUniform1i(glGetUniformLocation(program, "octaves"), octave);
+    glUniform1fv(glGetUniformLocation(program, "octaveAmplitude"), octave, octaveAmplitude);
+    glUniform1iv(glGetUniformLocation(program, "octaveZCell"), octave, octaveZCell);
+    glUniform1fv(glGetUniformLocation(program, "octaveZFraction"), octave, octaveZFraction);
+    glUniform1f(glGetUniformLocation(program, "maxAmplitude"), static_cast<GLfloat>(maxAmplitude));
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, columns, rows);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+
+    heights.resize(static_cast<size_t>(columns) * rows);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glReadPixels(0, 0, columns, rows, GL_RED, GL_FLOAT, heights.data());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, boundFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (depthTest) glEnable(GL_DEPTH_TEST);
+    if (cullFace) glEnable(GL_CULL_FACE);
+    glUseProgram(currentProgram);
+    for (int unit = 0; unit < 3; ++unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, boundTextures[unit]);
+    }
+    glActiveTexture(activeTexture);
+
+    timer.addCounter("vertices", static_cast<long long>(heights.size()));
+    return true;
+}
+
+const GLuint& GpuNoise::getHeightTexture() const {
+    return heightTexture;
+}
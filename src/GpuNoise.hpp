@@ -0,0 +1,41 @@
+#ifndef GPU_NOISE_HPP
+#define GPU_NOISE_HPP
+
+#include <GL/glew.h>
+#include <vector>
+#include "PerlinNoise.hpp"
+#include "ProgramCache.hpp"
+
+// Evaluates the terrain noise of TerrainMesh::generateBaseTerrain in a fragment shader, one fragment
+// per grid vertex, into a 32-bit float texture. The shader uses the permutation table of the given
+// PerlinNoise and sample coordinates prepared in double precision, but evaluates the noise in single
+// precision, so heights differ slightly from the CPU ones (see README). Needs GLSL 1.30 and float
+// render targets; all calls on the GL thread.
+class GpuNoise {
+public:
+    static const int maxOctaves = 32; // Size of the octave uniform arrays
+
+    GpuNoise();
+    ~GpuNoise();
+
+    GpuNoise(const GpuNoise&) = delete;
+    GpuNoise& operator=(const GpuNoise&) = delete;
+
+    bool init(ProgramCache& programCache); // False if the shader does not build or float textures cannot be rendered to
+    // Fill heights with noise + 1.5 for every vertex of a width x width grid, row by row, as
+    // TerrainMesh::generateBaseTerrainFromNoise expects it. Returns false if octave is over maxOctaves.
+    bool generate(const PerlinNoise& noise, int width, int step, double frequency, int octave, double amplitude,
+                  double persistence, double lacunarity, std::vector<float>& heights);
+    const GLuint& getHeightTexture() const; // Result of the last generate
+
+private:
+    void resize(int columns, int rows);
+
+    GLuint program;
+    GLuint VAO, VBO;
+    GLuint framebuffer, heightTexture, permutationTexture;
+    GLuint latticeTextures[2]; // Lattice cell and fraction of the x and z sample coordinates per octave
+    int textureColumns, textureRows;
+};
+
+#endif // GPU_NOISE_HPP
@@ -0,0 +1,31 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64-bit FNV-1a, used to name the terrain and shader program cache files
+
+const uint64_t fnvOffsetBasis = 14695981039346656037ull;
+
+inline void hashBytes(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+template <typename T>
+void hashValue(uint64_t& hash, T value) {
+    hashBytes(hash, &value, sizeof(value));
+}
+
+// Length first, so moving text from one string to the next still changes the hash
+inline void hashString(uint64_t& hash, const std::string& text) {
+    hashValue(hash, static_cast<uint64_t>(text.size()));
+    hashBytes(hash, text.data(), text.size());
+}
+
+#endif // HASH_HPP
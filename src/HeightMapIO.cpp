@@ -0,0 +1,400 @@
+#include "HeightMapIO.hpp"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#ifdef TERRAIN_HAVE_PNG
+#include <png.h>
+#endif
+
+namespace {
+
+uint16_t loadLE16(const unsigned char* bytes) {
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+uint16_t loadBE16(const unsigned char* bytes) {
+    return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+}
+
+uint32_t loadLE32(const unsigned char* bytes) {
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+float loadLE32f(const unsigned char* bytes) {
+    return std::bit_cast<float>(loadLE32(bytes));
+}
+
+void storeLE16(unsigned char* bytes, uint16_t value) {
+    bytes[0] = static_cast<unsigned char>(value);
+    bytes[1] = static_cast<unsigned char>(value >> 8);
+}
+
+void storeBE16(unsigned char* bytes, uint16_t value) {
+    bytes[0] = static_cast<unsigned char>(value >> 8);
+    bytes[1] = static_cast<unsigned char>(value);
+}
+
+void storeLE32(unsigned char* bytes, uint32_t value) {
+    for (int i = 0; i < 4; ++i) bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+bool endsWith(const std::string& text, const char* suffix) {
+    const size_t length = std::strlen(suffix);
+    if (text.size() < length) return false;
+    for (size_t i = 0; i < length; ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[text.size() - length + i])) != suffix[i]) return false;
+    }
+    return true;
+}
+
+// Map the heights onto 0..65535 between their minimum and maximum
+struct Quantizer {
+    float minHeight, maxHeight, scale;
+
+    Quantizer(const float* heights, size_t count)
+        : minHeight(std::numeric_limits<float>::max()), maxHeight(std::numeric_limits<float>::lowest()) {
+        for (size_t i = 0; i < count; ++i) {
+            minHeight = std::min(minHeight, heights[i]);
+            maxHeight = std::max(maxHeight, heights[i]);
+        }
+        scale = maxHeight > minHeight ? 65535.0f / (maxHeight - minHeight) : 0.0f;
+    }
+
+    uint16_t operator()(float height) const {
+        return static_cast<uint16_t>(std::lround((height - minHeight) * scale));
+    }
+};
+
+bool writeRaw(const std::string& path, const float* heights, int columns, int rows, int bits) {
+    const size_t count = static_cast<size_t>(columns) * rows;
+    const Quantizer quantize(heights, count);
+
+    RawHeightMapHeader header = {};
+    std::memcpy(header.magic, "TRNHMAP", 8);
+    header.version = rawHeightMapVersion;
+    header.bitsPerSample = static_cast<uint32_t>(bits);
+    header.columns = static_cast<uint32_t>(columns);
+    header.rows = static_cast<uint32_t>(rows);
+    header.minHeight = quantize.minHeight;
+    header.maxHeight = quantize.maxHeight;
+
+    // The header is written field by field so the file is little-endian on any host
+    unsigned char headerBytes[sizeof(RawHeightMapHeader)];
+    std::memcpy(headerBytes, header.magic, 8);
+    storeLE32(headerBytes + 8, header.version);
+    storeLE32(headerBytes + 12, header.bitsPerSample);
+    storeLE32(headerBytes + 16, header.columns);
+    storeLE32(headerBytes + 20, header.rows);
+    storeLE32(headerBytes + 24, std::bit_cast<uint32_t>(header.minHeight));
+    storeLE32(headerBytes + 28, std::bit_cast<uint32_t>(header.maxHeight));
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(headerBytes), sizeof(headerBytes));
+    std::vector<unsigned char> row(static_cast<size_t>(columns) * bits / 8);
+    for (int z = 0; z < rows; ++z) {
+        const float* source = heights + static_cast<size_t>(z) * columns;
+        for (int x = 0; x < columns; ++x) {
+            if (bits == 16) {
+                storeLE16(&row[x * 2], quantize(source[x]));
+            } else {
+                storeLE32(&row[x * 4], std::bit_cast<uint32_t>(source[x]));
+            }
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+    return static_cast<bool>(file);
+}
+
+bool writePgm(const std::string& path, const float* heights, int columns, int rows) {
+    const Quantizer quantize(heights, static_cast<size_t>(columns) * rows);
+    std::ofstream file(path, std::ios::binary);
+    file.precision(9);
+    file << "P5\n# height_range " << quantize.minHeight << ' ' << quantize.maxHeight << '\n'
+         << columns << ' ' << rows << "\n65535\n";
+    std::vector<unsigned char> row(static_cast<size_t>(columns) * 2);
+    for (int z = 0; z < rows; ++z) {
+        const float* source = heights + static_cast<size_t>(z) * columns;
+        for (int x = 0; x < columns; ++x) storeBE16(&row[x * 2], quantize(source[x]));
+        file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+    return static_cast<bool>(file);
+}
+
+#ifdef TERRAIN_HAVE_PNG
+bool writePng(const std::string& path, const float* heights, int columns, int rows) {
+    const Quantizer quantize(heights, static_cast<size_t>(columns) * rows);
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    // Everything with a destructor is created before setjmp, which libpng errors jump back to
+    std::vector<unsigned char> row(static_cast<size_t>(columns) * 2);
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        std::fclose(file);
+        return false;
+    }
+    png_init_io(png, file);
+    png_set_IHDR(png, info, columns, rows, 16, PNG_COLOR_TYPE_GRAY, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    char range[64];
+    std::snprintf(range, sizeof(range), "%.9g %.9g", quantize.minHeight, quantize.maxHeight);
+    png_text text = {};
+    text.compression = PNG_TEXT_COMPRESSION_NONE;
+    text.key = const_cast<char*>("height_range");
+    text.text = range;
+    png_set_text(png, info, &text, 1);
+    png_write_info(png, info);
+    for (int z = 0; z < rows; ++z) {
+        const float* source = heights + static_cast<size_t>(z) * columns;
+        for (int x = 0; x < columns; ++x) storeBE16(&row[x * 2], quantize(source[x])); // PNG samples are big-endian
+        png_write_row(png, row.data());
+    }
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+    return std::fclose(file) == 0;
+}
+#endif
+
+} // namespace
+
+bool heightMapFormatFromPath(const std::string& path, HeightMapFormat& format) {
+    if (endsWith(path, ".r16")) format = HeightMapFormat::Raw16;
+    else if (endsWith(path, ".r32")) format = HeightMapFormat::Raw32;
+    else if (endsWith(path, ".pgm")) format = HeightMapFormat::Pgm;
+    else if (endsWith(path, ".png")) format = HeightMapFormat::Png;
+    else return false;
+    return true;
+}
+
+bool writeHeightMap(const std::string& path, const float* heights, int columns, int rows) {
+    HeightMapFormat format;
+    if (!heightMapFormatFromPath(path, format)) {
+        std::cerr << "Unknown height map format (use .r16, .r32, .pgm or .png): " << path << '\n';
+        return false;
+    }
+    bool written = false;
+    switch (format) {
+    case HeightMapFormat::Raw16: written = writeRaw(path, heights, columns, rows, 16); break;
+    case HeightMapFormat::Raw32: written = writeRaw(path, heights, columns, rows, 32); break;
+    case HeightMapFormat::Pgm: written = writePgm(path, heights, columns, rows); break;
+    case HeightMapFormat::Png:
+#ifdef TERRAIN_HAVE_PNG
+        written = writePng(path, heights, columns, rows);
+#else
+        std::cerr << "Built without libpng, cannot write " << path << '\n';
+        return false;
+#endif
+        break;
+    }
+    if (!written) std::cerr << "Could not write height map: " << path << '\n';
+    return written;
+}
+
+HeightMapFile::HeightMapFile(const std::string& path)
+    : format(HeightMapFormat::Raw32), samples(nullptr), columns(0), rows(0), bitsPerSample(0), sampleMax(1),
+      minHeight(0.0f), maxHeight(1.0f), ranged(false), open(false) {
+    if (!heightMapFormatFromPath(path, format)) {
+        error = "unknown height map format (use .r16, .r32, .pgm or .png)";
+        return;
+    }
+    if (format == HeightMapFormat::Png) {
+        open = openPng(path);
+        return;
+    }
+    file = MappedFile(path);
+    if (!file.isOpen()) {
+        error = "cannot open the file";
+        return;
+    }
+    open = format == HeightMapFormat::Pgm ? openPgm() : openRaw();
+}
+
+bool HeightMapFile::openRaw() {
+    const unsigned char* bytes = file.data();
+    if (file.size() < sizeof(RawHeightMapHeader) || std::memcmp(bytes, "TRNHMAP", 8) != 0) {
+        error = "not a raw height map";
+        return false;
+    }
+    const uint32_t version = loadLE32(bytes + 8);
+    bitsPerSample = static_cast<int>(loadLE32(bytes + 12));
+    columns = static_cast<int>(loadLE32(bytes + 16));
+    rows = static_cast<int>(loadLE32(bytes + 20));
+    minHeight = loadLE32f(bytes + 24);
+    maxHeight = loadLE32f(bytes + 28);
+    const int expectedBits = format == HeightMapFormat::Raw16 ? 16 : 32;
+    if (version != rawHeightMapVersion || bitsPerSample != expectedBits || columns <= 0 || rows <= 0 ||
+        file.size() != sizeof(RawHeightMapHeader) + static_cast<size_t>(columns) * rows * bitsPerSample / 8) {
+        error = "unsupported or truncated raw height map";
+        return false;
+    }
+    samples = bytes + sizeof(RawHeightMapHeader);
+    sampleMax = 65535;
+    ranged = true;
+    return true;
+}
+
+// P5 header: magic, width, height and maxval separated by whitespace or comments, then one whitespace byte
+bool HeightMapFile::openPgm() {
+    const unsigned char* bytes = file.data();
+    const size_t size = file.size();
+    size_t at = 2;
+    if (size < 2 || bytes[0] != 'P' || bytes[1] != '5') {
+        error = "not a binary PGM";
+        return false;
+    }
+    auto readNumber = [&](int& value) {
+        while (at < size) {
+            if (bytes[at] == '#') {
+                size_t end = at;
+                while (end < size && bytes[end] != '\n') ++end;
+                std::string comment(reinterpret_cast<const char*>(bytes) + at, end - at);
+                float low, high;
+                if (std::sscanf(comment.c_str(), "# height_range %f %f", &low, &high) == 2) {
+                    minHeight = low;
+                    maxHeight = high;
+                    ranged = true;
+                }
+                at = end;
+            } else if (std::isspace(bytes[at])) {
+                ++at;
+            } else {
+                break;
+            }
+        }
+        value = 0;
+        const size_t start = at;
+        while (at < size && std::isdigit(bytes[at]) && value < (1 << 24)) value = value * 10 + (bytes[at++] - '0');
+        return at > start;
+    };
+    if (!readNumber(columns) || !readNumber(rows) || !readNumber(sampleMax) || at >= size ||
+        columns <= 0 || rows <= 0 || sampleMax <= 0 || sampleMax > 65535) {
+        error = "malformed PGM header";
+        return false;
+    }
+    ++at; // Single whitespace before the samples
+    bitsPerSample = sampleMax > 255 ? 16 : 8;
+    if (size - at != static_cast<size_t>(columns) * rows * bitsPerSample / 8) {
+        error = "truncated PGM";
+        return false;
+    }
+    samples = bytes + at;
+    return true;
+}
+
+bool HeightMapFile::openPng(const std::string& path) {
+#ifdef TERRAIN_HAVE_PNG
+    FILE* input = std::fopen(path.c_str(), "rb");
+    if (!input) {
+        error = "cannot open the file";
+        return false;
+    }
+    std::vector<png_bytep> rowPointers; // Created before setjmp, which libpng errors jump back to
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        std::fclose(input);
+        error = "cannot decode the PNG";
+        return false;
+    }
+    png_init_io(png, input);
+    png_read_info(png, info);
+    if (png_get_color_type(png, info) != PNG_COLOR_TYPE_GRAY) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        std::fclose(input);
+        error = "PNG height maps must be grayscale";
+        return false;
+    }
+    columns = static_cast<int>(png_get_image_width(png, info));
+    rows = static_cast<int>(png_get_image_height(png, info));
+    png_set_expand_gray_1_2_4_to_8(png);
+    if (png_get_bit_depth(png, info) < 16) png_set_expand_16(png);
+    png_set_strip_alpha(png); // png_set_expand_16 turns a tRNS chunk into an alpha channel
+    if (std::endian::native == std::endian::little) png_set_swap(png);
+    png_textp texts;
+    int textCount = 0;
+    png_get_text(png, info, &texts, &textCount);
+    for (int i = 0; i < textCount; ++i) {
+        float low, high;
+        if (std::strcmp(texts[i].key, "height_range") == 0 && std::sscanf(texts[i].text, "%f %f", &low, &high) == 2) {
+            minHeight = low;
+            maxHeight = high;
+            ranged = true;
+        }
+    }
+    png_read_update_info(png, info);
+    if (png_get_rowbytes(png, info) != static_cast<size_t>(columns) * 2) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        std::fclose(input);
+        error = "PNG height maps must decode to one 16-bit sample per pixel";
+        return false;
+    }
+    decoded.resize(static_cast<size_t>(columns) * rows);
+    rowPointers.resize(rows);
+    for (int z = 0; z < rows; ++z) rowPointers[z] = reinterpret_cast<png_bytep>(&decoded[static_cast<size_t>(z) * columns]);
+    png_read_image(png, rowPointers.data());
+    png_read_end(png, nullptr);
+    png_destroy_read_struct(&png, &info, nullptr);
+    std::fclose(input);
+    bitsPerSample = 16;
+    sampleMax = 65535;
+    return true;
+#else
+    (void)path;
+    error = "built without libpng";
+    return false;
+#endif
+}
+
+bool HeightMapFile::isOpen() const {
+    return open;
+}
+
+const std::string& HeightMapFile::getError() const {
+    return error;
+}
+
+const int& HeightMapFile::getColumns() const {
+    return columns;
+}
+
+const int& HeightMapFile::getRows() const {
+    return rows;
+}
+
+bool HeightMapFile::hasRange() const {
+    return ranged;
+}
+
+void HeightMapFile::readRow(int row, float* heights) const {
+    const size_t first = static_cast<size_t>(row) * columns;
+    const float low = ranged ? minHeight : 0.0f;
+    const float scale = (ranged ? maxHeight - minHeight : 1.0f) / sampleMax;
+    if (format == HeightMapFormat::Png) {
+        for (int x = 0; x < columns; ++x) heights[x] = low + decoded[first + x] * scale;
+    } else if (format == HeightMapFormat::Raw32) {
+        const unsigned char* source = samples + first * 4;
+        if (std::endian::native == std::endian::little) {
+            std::memcpy(heights, source, static_cast<size_t>(columns) * 4);
+        } else {
+            for (int x = 0; x < columns; ++x) heights[x] = loadLE32f(source + x * 4);
+        }
+    } else if (format == HeightMapFormat::Raw16) {
+        const unsigned char* source = samples + first * 2;
+        for (int x = 0; x < columns; ++x) heights[x] = low + loadLE16(source + x * 2) * scale;
+    } else if (bitsPerSample == 16) {
+        const unsigned char* source = samples + first * 2;
+        for (int x = 0; x < columns; ++x) heights[x] = low + loadBE16(source + x * 2) * scale;
+    } else {
+        const unsigned char* source = samples + first;
+        for (int x = 0; x < columns; ++x) heights[x] = low + source[x] * scale;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef HEIGHT_MAP_IO_HPP
+#define HEIGHT_MAP_IO_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.hpp"
+
+// Height map file formats, picked by file extension:
+//   .r16 / .r32  RawHeightMapHeader followed by little-endian uint16 samples or float heights, row by row
+//   .pgm         16-bit binary PGM (P5); the height range is kept in a "# height_range <min> <max>" comment
+//   .png         16-bit grayscale PNG; the height range is kept in a "height_range" text chunk (needs libpng)
+// 16-bit samples map linearly from 0..65535 onto the stored height range.
+enum class HeightMapFormat {Raw16, Raw32, Pgm, Png};
+
+struct RawHeightMapHeader {
+    char magic[8]; // "TRNHMAP" and a zero byte
+    uint32_t version;
+    uint32_t bitsPerSample; // 16 or 32
+    uint32_t columns, rows;
+    float minHeight, maxHeight; // Range of the 16-bit samples; informational for 32-bit files
+};
+
+const uint32_t rawHeightMapVersion = 1;
+
+bool heightMapFormatFromPath(const std::string& path, HeightMapFormat& format);
+
+// Write columns * rows heights, row by row. Returns false (and prints why) on failure.
+bool writeHeightMap(const std::string& path, const float* heights, int columns, int rows);
+
+// A height map opened for import. Raw and PGM files are mapped and converted row by row straight
+// from the mapping, so opening one reads nothing but the header; PNG files are decoded up front.
+class HeightMapFile {
+public:
+    explicit HeightMapFile(const std::string& path);
+
+    bool isOpen() const;
+    const std::string& getError() const; // Why isOpen is false
+    const int& getColumns() const;
+    const int& getRows() const;
+    // Files without a stored height range read as 0..1
+    bool hasRange() const;
+    // Convert one row into getColumns() heights. Safe to call from several threads at once.
+    void readRow(int row, float* heights) const;
+
+private:
+    bool openRaw();
+    bool openPgm();
+    bool openPng(const std::string& path);
+
+    HeightMapFormat format;
+    MappedFile file;
+    const unsigned char* samples; // First sample in the mapping
+    std::vector<uint16_t> decoded; // PNG samples
+    int columns, rows;
+    int bitsPerSample; // 8 only for PGM files with a maxval below 256
+    int sampleMax;     // Sample value of the top of the height range
+    float minHeight, maxHeight;
+    bool ranged, open;
+    std::string error;
+};
+
+#endif // HEIGHT_MAP_IO_HPP
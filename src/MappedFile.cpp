@@ -0,0 +1,55 @@
+#include "MappedFile.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            mapping = data;
+            length = static_cast<size_t>(info.st_size);
+        }
+    }
+    ::close(fd); // The mapping keeps the file alive
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : mapping(std::exchange(other.mapping, nullptr)), length(std::exchange(other.length, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        mapping = std::exchange(other.mapping, nullptr);
+        length = std::exchange(other.length, 0);
+    }
+    return *this;
+}
+
+void MappedFile::close() {
+    if (mapping) munmap(mapping, length);
+    mapping = nullptr;
+    length = 0;
+}
+
+bool MappedFile::isOpen() const {
+    return mapping != nullptr;
+}
+
+const unsigned char* MappedFile::data() const {
+    return static_cast<const unsigned char*>(mapping);
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The pages are loaded on first access, so opening a
+// large file costs almost nothing until its data is read.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool isOpen() const; // False if the file is missing, empty or could not be mapped
+    const unsigned char* data() const;
+    size_t size() const;
+
+private:
+    void close();
+
+    void* mapping = nullptr;
+    size_t length = 0;
+};
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,43 @@
+#include "NoiseLayers.hpp"
+
+NoiseLayerCache::NoiseLayerCache()
+    : layerCount(0), sampleCount(0), width(0), step(0), frequency(0.0), lacunarity(0.0) {
+}
+
+void NoiseLayerCache::prepare(int width_, int step_, const std::vector<int>& permutation_, double frequency_, double lacunarity_) {
+    if (width_ == width && step_ == step && frequency_ == frequency && lacunarity_ == lacunarity && permutation_ == permutation) {
+        return;
+    }
+    width = width_;
+    step = step_;
+    permutation = permutation_;
+    frequency = frequency_;
+    lacunarity = lacunarity_;
+    sampleCount = static_cast<size_t>(width / step) * (width / step);
+    layerCount = 0;
+}
+
+const size_t& NoiseLayerCache::getLayerCount() const {
+    return layerCount;
+}
+
+const size_t& NoiseLayerCache::getSampleCount() const {
+    return sampleCount;
+}
+
+const std::vector<double>& NoiseLayerCache::getLayer(size_t octave) const {
+    return layers[octave];
+}
+
+std::vector<double>& NoiseLayerCache::addLayer() {
+    if (layers.size() == layerCount) layers.emplace_back();
+    std::vector<double>& layer = layers[layerCount++];
+    layer.resize(sampleCount);
+    return layer;
+}
+
+void NoiseLayerCache::clear() {
+    layers.clear();
+    layerCount = 0;
+    width = 0;
+}
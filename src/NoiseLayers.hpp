@@ -0,0 +1,33 @@
+#ifndef NOISE_LAYERS_HPP
+#define NOISE_LAYERS_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Unweighted noise of each fBm octave for every vertex of a terrain grid, kept between generations
+// so TerrainMesh::generateBaseTerrain only evaluates octaves it has not seen yet. A layer depends on
+// the grid, the permutation table, the base frequency and the lacunarity; amplitude, persistence and
+// the octave count only change how the layers are summed. One double per vertex and layer.
+// Not thread-safe: use it for one generation at a time.
+class NoiseLayerCache {
+public:
+    NoiseLayerCache();
+
+    // Drop all layers unless they were made for this grid, permutation, frequency and lacunarity
+    void prepare(int width, int step, const std::vector<int>& permutation, double frequency, double lacunarity);
+    const size_t& getLayerCount() const;
+    const size_t& getSampleCount() const;
+    const std::vector<double>& getLayer(size_t octave) const;
+    std::vector<double>& addLayer(); // Sized for the grid; filled by the caller
+    void clear();
+
+private:
+    std::vector<std::vector<double>> layers;
+    size_t layerCount; // Layers in use; the vectors past it keep their memory for reuse
+    size_t sampleCount;
+    int width, step;
+    std::vector<int> permutation;
+    double frequency, lacunarity;
+};
+
+#endif // NOISE_LAYERS_HPP
@@ -0,0 +1,80 @@
+#include "OffscreenContext.hpp"
+#include <cstring>
+
+#ifdef TERRAIN_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+OffscreenContext::OffscreenContext()
+    : display(nullptr), surface(nullptr), context(nullptr) {
+}
+
+#ifdef TERRAIN_HAVE_EGL
+
+OffscreenContext::~OffscreenContext() {
+    if (!display) return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context) eglDestroyContext(display, context);
+    if (surface) eglDestroySurface(display, surface);
+    eglTerminate(display);
+}
+
+bool OffscreenContext::create(int width, int height) {
+    // Prefer a display that needs no window system at all
+    const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+    }
+    if (!display) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (!display || !eglInitialize(display, nullptr, nullptr)) {
+        error = "no EGL display";
+        display = nullptr;
+        return false;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        error = "no EGL config with an OpenGL pbuffer";
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        error = "EGL cannot bind the desktop OpenGL API";
+        return false;
+    }
+
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+    surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    // The default (compatibility) context, since the shaders are GLSL 1.20 and write gl_FragColor
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context)) {
+        error = "could not create and bind an EGL pbuffer context";
+        return false;
+    }
+    return true;
+}
+
+#else
+
+OffscreenContext::~OffscreenContext() {
+}
+
+bool OffscreenContext::create(int, int) {
+    error = "built without EGL";
+    return false;
+}
+
+#endif
+
+const std::string& OffscreenContext::getError() const {
+    return error;
+}
@@ -0,0 +1,28 @@
+#ifndef OFFSCREEN_CONTEXT_HPP
+#define OFFSCREEN_CONTEXT_HPP
+
+#include <string>
+
+// An OpenGL context rendering into an EGL pbuffer, for running without a window or display
+// (e.g. Mesa llvmpipe in CI). Uses the surfaceless platform when EGL offers it, otherwise the
+// default display. Only available when the build found EGL (TERRAIN_HAVE_EGL).
+class OffscreenContext {
+public:
+    OffscreenContext();
+    ~OffscreenContext();
+
+    OffscreenContext(const OffscreenContext&) = delete;
+    OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+    // Create the context and make it current. Returns false (see getError) on failure.
+    bool create(int width, int height);
+    const std::string& getError() const;
+
+private:
+    void* display; // EGLDisplay, EGLSurface and EGLContext, kept opaque so egl.h stays out of the header
+    void* surface;
+    void* context;
+    std::string error;
+};
+
+#endif // OFFSCREEN_CONTEXT_HPP
@@ -1,14 +1,29 @@
 #include "PerlinNoise.hpp"
+#include "PerlinNoiseSimd.hpp"
 #include <algorithm>
 #include <cmath>
+#include <numeric>
 #include <random>
 #include <iostream>
 
-const int PerlinNoise::gradientVectors[12][3] = {
-    {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0},
-    {1, 1, 0}, {-1, 1, 0}, {1, -1, 0}, {-1, -1, 0},
-    {1, 0, 1}, {-1, 0, 1}, {0, 1, 1}, {0, -1, 1}
-};
+namespace {
+
+SimdLevel activeSimdLevel = PerlinNoise::detectSimdLevel();
+
+// Number of samples evaluated per octave pass in generateNoiseBatch, small enough to stay in L1
+const std::size_t batchChunkSize = 256;
+
+// v moved by a multiple of the 256-cell lattice period into [-128, 128], where a float still resolves
+// the fraction to 2^-17; the noise is the same, as the lattice index is taken & 255. Adding and
+// subtracting 1.5 * 2^52 rounds to a whole number of periods without a conversion, so the loops
+// calling this vectorize with plain SSE2 (|v| stays far below 2^59).
+float wrapLattice(double v) {
+    const double roundingBias = 6755399441055744.0;
+    const double periods = (v * (1.0 / 256.0) + roundingBias) - roundingBias;
+    return static_cast<float>(v - 256.0 * periods);
+}
+
+} // namespace
 
 // Constructor
 PerlinNoise::PerlinNoise(int seed, int init_octave) 
@@ -25,36 +40,143 @@ void PerlinNoise::initialize(const int& seed) {
     p.insert(p.end(), p.begin(), p.end());
 }
 
+const std::vector<int>& PerlinNoise::getPermutation() const {
+    return p;
+}
+
 // Generate the noise value at a given position
 double PerlinNoise::noise(double x, double y, double z) const {
-    int X = (int)std::floor(x) & 255;
-    int Y = (int)std::floor(y) & 255;
-    int Z = (int)std::floor(z) & 255;
-
-    x -= std::floor(x);
-    y -= std::floor(y);
-    z -= std::floor(z);
-
-    double u = fade(x);
-    double v = fade(y);
-    double w = fade(z);
-
-	// Hash coordinates of the 8 cube corners
-	int A = p[X] + Y;
-	int AA = p[A] + Z;
-	int AB = p[A + 1] + Z;
-	int B = p[X + 1] + Y;
-	int BA = p[B] + Z;
-	int BB = p[B + 1] + Z;
-
-	// Add blended results from 8 corners of cube
-	double res = lerp(w, lerp(v, lerp(u, grad(p[AA], x, y, z), grad(p[BA], x-1, y, z)), lerp(u, grad(p[AB], x, y-1, z), grad(p[BB], x-1, y-1, z))),	lerp(v, lerp(u, grad(p[AA+1], x, y, z-1), grad(p[BA+1], x-1, y, z-1)), lerp(u, grad(p[AB+1], x, y-1, z-1),	grad(p[BB+1], x-1, y-1, z-1))));
-	return (res + 1.0)/2.0;
+    return noise<double, 3>(x, y, z);
+}
+
+// Evaluate a batch of noise values with the active kernel, falling back to noise() one sample at a time
+void PerlinNoise::noiseBatch(const double* x, const double* y, double z, std::size_t count, double* out) const {
+    switch (activeSimdLevel) {
+#ifdef TERRAIN_X86_SIMD
+    case SimdLevel::AVX2:
+        noiseBatchAVX2(p.data(), x, y, z, count, out);
+        return;
+    case SimdLevel::SSE41:
+        noiseBatchSSE41(p.data(), x, y, z, count, out);
+        return;
+#endif
+    default:
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = noise(x[i], y[i], z);
+        }
+    }
+}
+
+void PerlinNoise::noiseBatch(const float* x, const float* y, float z, std::size_t count, float* out) const {
+    switch (activeSimdLevel) {
+#ifdef TERRAIN_X86_SIMD
+    case SimdLevel::AVX2:
+        noiseBatchAVX2(p.data(), x, y, z, count, out);
+        return;
+    case SimdLevel::SSE41:
+        noiseBatchSSE41(p.data(), x, y, z, count, out);
+        return;
+#endif
+    default:
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<float>(noise(x[i], y[i], z));
+        }
+    }
+}
+
+// Generate the noise values for a batch of positions with multiple octaves.
+// Works octave by octave over chunks of samples so each octave is one batch kernel call.
+void PerlinNoise::generateNoiseBatch(const double* x, const double* y, double z, std::size_t count, double* out, double frequency
+                                    , double amplitude, int octave, double persistence, double lacunarity) const {
+    double scaledX[batchChunkSize], scaledY[batchChunkSize], octaveNoise[batchChunkSize], noiseValue[batchChunkSize];
+
+    for (std::size_t begin = 0; begin < count; begin += batchChunkSize) {
+        const std::size_t n = std::min(batchChunkSize, count - begin);
+        double octaveFrequency = frequency;
+        double octaveAmplitude = amplitude;
+        double maxAmplitude = 0.0;
+        std::fill(noiseValue, noiseValue + n, 0.0);
+
+        for (int i = 0; i < octave; ++i) {
+            for (std::size_t j = 0; j < n; ++j) {
+                scaledX[j] = x[begin + j] * octaveFrequency;
+                scaledY[j] = y[begin + j] * octaveFrequency;
+            }
+            noiseBatch(scaledX, scaledY, z * octaveFrequency, n, octaveNoise);
+            for (std::size_t j = 0; j < n; ++j) {
+                noiseValue[j] += octaveAmplitude * octaveNoise[j];
+            }
+
+            maxAmplitude += octaveAmplitude;
+            octaveFrequency *= lacunarity;
+            octaveAmplitude *= persistence;
+        }
+
+        // Same mapping as generateNoise
+        for (std::size_t j = 0; j < n; ++j) {
+            double value = noiseValue[j] / maxAmplitude;
+            value = 2.0 * value - 1.0;
+            out[begin + j] = value * maxAmplitude;
+        }
+    }
+}
+
+void PerlinNoise::generateNoiseBatch(const double* x, const double* y, double z, std::size_t count, float* out, double frequency
+                                    , double amplitude, int octave, double persistence, double lacunarity) const {
+    float scaledX[batchChunkSize], scaledY[batchChunkSize], octaveNoise[batchChunkSize], noiseValue[batchChunkSize];
+
+    for (std::size_t begin = 0; begin < count; begin += batchChunkSize) {
+        const std::size_t n = std::min(batchChunkSize, count - begin);
+        double octaveFrequency = frequency;
+        double octaveAmplitude = amplitude;
+        double maxAmplitude = 0.0;
+        std::fill(noiseValue, noiseValue + n, 0.0f);
+
+        for (int i = 0; i < octave; ++i) {
+            for (std::size_t j = 0; j < n; ++j) {
+                scaledX[j] = wrapLattice(x[begin + j] * octaveFrequency);
+                scaledY[j] = wrapLattice(y[begin + j] * octaveFrequency);
+            }
+            noiseBatch(scaledX, scaledY, wrapLattice(z * octaveFrequency), n, octaveNoise);
+            const float weight = static_cast<float>(octaveAmplitude);
+            for (std::size_t j = 0; j < n; ++j) {
+                noiseValue[j] += weight * octaveNoise[j];
+            }
+
+            maxAmplitude += octaveAmplitude;
+            octaveFrequency *= lacunarity;
+            octaveAmplitude *= persistence;
+        }
+
+        // Same mapping as generateNoise
+        const float sum = static_cast<float>(maxAmplitude);
+        for (std::size_t j = 0; j < n; ++j) {
+            out[begin + j] = 2.0f * noiseValue[j] - sum;
+        }
+    }
+}
+
+// Pick the widest kernel the CPU (and this build) supports
+SimdLevel PerlinNoise::detectSimdLevel() {
+#if defined(TERRAIN_X86_SIMD) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SimdLevel::SSE41;
+#endif
+    return SimdLevel::Scalar;
+}
+
+SimdLevel PerlinNoise::getSimdLevel() {
+    return activeSimdLevel;
+}
+
+void PerlinNoise::setSimdLevel(SimdLevel level) {
+    activeSimdLevel = std::min(level, detectSimdLevel());
 }
 
 // Generate the noise value at a given position with multiple octaves
 double PerlinNoise::generateNoise(double x, double y, double z, double frequency, double amplitude, int octave
-                                    , double persistence, double lacunarity) {
+                                    , double persistence, double lacunarity) const {
     double noiseValue = 0.0;
     double maxAmplitude = 0.0;
 
@@ -77,7 +199,7 @@ double PerlinNoise::generateNoise(double x, double y, double z, double frequency
 }
 
 // for the boundary points, the height is always set to above the water level 
-double PerlinNoise::adjustNoiseForTerrainShape(double noiseValue, double x, double z, double width, double height, int step, double waterLevel) {
+double PerlinNoise::adjustNoiseForTerrainShape(double noiseValue, double x, double z, double width, double height, int step, double waterLevel) const {
     if (x == width / 2 - step || z == height / 2 - step || x == - width / 2 || z == - width / 2) {
         if(noiseValue < waterLevel) {
             noiseValue = (waterLevel - noiseValue) * 0.2 + waterLevel;
@@ -87,24 +209,3 @@ double PerlinNoise::adjustNoiseForTerrainShape(double noiseValue, double x, doub
         }
     }else return noiseValue;
 }
-
-
-// Fade function
-double PerlinNoise::fade(double t) const {
-    return t * t * t * (t * (t * 6 - 15) + 10);
-}
-
-// Linear interpolation
-double PerlinNoise::lerp(double t, double a, double b) const {
-    return a + t * (b - a);
-}
-
-// Gradient function
-double PerlinNoise::grad(int hash, double x, double y, double z) const {
-    int h = hash & 11;
-    double u = gradientVectors[h][0];
-    double v = gradientVectors[h][1];
-    double w = gradientVectors[h][2];
-    return u * x + v * y + w * z;
-}
-
@@ -1,7 +1,14 @@
 #ifndef PERLINNOISE_HPP
 #define PERLINNOISE_HPP
 
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
 #include <vector>
+#include "FixedPoint.hpp"
+
+// Instruction sets the batch noise kernels can run on
+enum class SimdLevel { Scalar, SSE41, AVX2 };
 
 class PerlinNoise {
 public:
@@ -9,24 +16,145 @@ public:
 
     double noise(double x, double y , double z) const;
 
+    // Compile-time variants of noise(). Real is the scalar type the whole evaluation runs in: float,
+    // double or the Q16.16 Fixed16, which needs no FPU and stays within 2e-4 of the double result.
+    // Dimensions 3 is the 3D noise the terrain uses; noise<double, 3> is noise(). Dimensions 2 is
+    // classic 2D Perlin noise over 4 corners with diagonal gradients and ignores z: about half the
+    // work, but a different function, so heights made with it do not match the 3D terrain.
+    template <typename Real, int Dimensions = 3>
+    Real noise(Real x, Real y, Real z = Real(0.5)) const;
+
+    // generateNoise() with the octave count fixed at compile time, so the octave loop unrolls.
+    // generateNoise<Octaves, double, 3> gives the same result as generateNoise(..., Octaves, ...).
+    template <int Octaves, typename Real = double, int Dimensions = 3>
+    Real generateNoise(Real x, Real y, Real z, Real frequency, Real amplitude, Real persistence, Real lacunarity) const;
+
+    // Evaluate noise(x[i], y[i], z) for count samples with the active SIMD kernel.
+    // The double version is bit-identical to noise(); the float version trades precision for twice the lanes.
+    void noiseBatch(const double* x, const double* y, double z, std::size_t count, double* out) const;
+    void noiseBatch(const float* x, const float* y, float z, std::size_t count, float* out) const;
+
+    // generateNoise() for count samples sharing the same z; same result as calling it per sample
+    void generateNoiseBatch(const double* x, const double* y, double z, std::size_t count, double* out, double frequency = 2.0
+                                    , double amplitude = 0.6, int octave = 10, double persistence = 0.5, double lacunarity = 2.0) const;
+    // The same sum through the float kernel. Each octave's coordinates are scaled in double and wrapped
+    // into the 256-cell period of the lattice before they are rounded to float, so the error does not
+    // grow with the frequency: within 1.5e-6 of the double sum wherever the double sum's lattice index
+    // does not overflow (see README).
+    void generateNoiseBatch(const double* x, const double* y, double z, std::size_t count, float* out, double frequency = 2.0
+                                    , double amplitude = 0.6, int octave = 10, double persistence = 0.5, double lacunarity = 2.0) const;
+
+    // The kernel is picked from the CPU features at startup; setSimdLevel can lower it (e.g. for benchmarks)
+    static SimdLevel getSimdLevel();
+    static void setSimdLevel(SimdLevel level);
+    static SimdLevel detectSimdLevel();
+
     double generateNoise(double x, double y, double z, double frequency = 2.0, double amplitude = 0.6, int octave = 10
-                                    , double persistence = 0.5, double lacunarity = 2.0);
+                                    , double persistence = 0.5, double lacunarity = 2.0) const;
 
-    double adjustNoiseForTerrainShape(double noiseValue, double x, double z, double width, double height, int step, double waterLevel);
+    double adjustNoiseForTerrainShape(double noiseValue, double x, double z, double width, double height, int step, double waterLevel) const;
 
     void setOctave(int newOctave) { octave = newOctave; }
     int getOctave() const { return octave; }
     void initialize(const int& seed);
+    const std::vector<int>& getPermutation() const; // 512 entries, the shuffled 0..255 twice
 
 private:
-    double fade(double t) const;
-    double lerp(double t, double a, double b) const;
-    double grad(int hash, double x, double y, double z) const;
+    template <typename Real>
+    static Real fade(Real t) { return t * t * t * (t * (t * 6 - 15) + 10); }
+    template <typename Real>
+    static Real lerp(Real t, Real a, Real b) { return a + t * (b - a); }
+    template <typename Real>
+    static Real grad(int hash, Real x, Real y, Real z);
+    template <typename Real>
+    static Real grad(int hash, Real x, Real y);
 
     std::vector<int> p; // Permutation table
     static const int permutationTableSize = 256; // Size of permutation table
-    static const int gradientVectors[12][3]; // Predefined gradient vectors
+    // Predefined gradient vectors. The 3D noise only ever uses rows {0,1,2,3,8,9,10,11} (hash & 11),
+    // the 2D noise the diagonals in rows 4 to 7.
+    static constexpr int gradientVectors[12][3] = {
+        {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0},
+        {1, 1, 0}, {-1, 1, 0}, {1, -1, 0}, {-1, -1, 0},
+        {1, 0, 1}, {-1, 0, 1}, {0, 1, 1}, {0, -1, 1}
+    };
     int octave;
 };
 
+template <typename Real>
+Real PerlinNoise::grad(int hash, Real x, Real y, Real z) {
+    const int* g = gradientVectors[hash & 11];
+    return Real(g[0]) * x + Real(g[1]) * y + Real(g[2]) * z;
+}
+
+template <typename Real>
+Real PerlinNoise::grad(int hash, Real x, Real y) {
+    const int* g = gradientVectors[4 + (hash & 3)];
+    return Real(g[0]) * x + Real(g[1]) * y;
+}
+
+// The generic fade truncates Fixed16 after every product; this one keeps 64-bit intermediates
+// and truncates twice
+template <>
+inline Fixed16 PerlinNoise::fade<Fixed16>(Fixed16 t) {
+    const int64_t x = t.raw;
+    const int64_t one = Fixed16::one;
+    const int64_t cube = (x * x * x) >> (2 * Fixed16::fractionBits);                // t^3
+    const int64_t polynomial = ((x * (x * 6 - 15 * one)) >> Fixed16::fractionBits) + 10 * one; // t * (t * 6 - 15) + 10
+    return Fixed16::fromRaw(static_cast<int32_t>((cube * polynomial) >> Fixed16::fractionBits));
+}
+
+template <typename Real, int Dimensions>
+Real PerlinNoise::noise(Real x, Real y, Real z) const {
+    static_assert(std::is_floating_point_v<Real> || std::is_same_v<Real, Fixed16>, "noise needs a floating point type or Fixed16");
+    static_assert(Dimensions == 2 || Dimensions == 3, "noise is 2D or 3D");
+    using std::floor; // Fixed16 brings its own
+    const Real fx = floor(x), fy = floor(y);
+    const int X = static_cast<int>(fx) & 255;
+    const int Y = static_cast<int>(fy) & 255;
+    x -= fx;
+    y -= fy;
+    const Real u = fade(x);
+    const Real v = fade(y);
+    const int A = p[X] + Y;
+    const int B = p[X + 1] + Y;
+
+    if constexpr (Dimensions == 2) {
+        const Real res = lerp(v, lerp(u, grad(p[A], x, y), grad(p[B], x - 1, y)),
+                                 lerp(u, grad(p[A + 1], x, y - 1), grad(p[B + 1], x - 1, y - 1)));
+        return (res + Real(1)) / Real(2);
+    } else {
+        const Real fz = floor(z);
+        const int Z = static_cast<int>(fz) & 255;
+        z -= fz;
+        const Real w = fade(z);
+        // Hash coordinates of the 8 cube corners
+        const int AA = p[A] + Z, AB = p[A + 1] + Z;
+        const int BA = p[B] + Z, BB = p[B + 1] + Z;
+        // Add blended results from 8 corners of cube
+        const Real res = lerp(w, lerp(v, lerp(u, grad(p[AA], x, y, z), grad(p[BA], x - 1, y, z)),
+                                         lerp(u, grad(p[AB], x, y - 1, z), grad(p[BB], x - 1, y - 1, z))),
+                                 lerp(v, lerp(u, grad(p[AA + 1], x, y, z - 1), grad(p[BA + 1], x - 1, y, z - 1)),
+                                         lerp(u, grad(p[AB + 1], x, y - 1, z - 1), grad(p[BB + 1], x - 1, y - 1, z - 1))));
+        return (res + Real(1)) / Real(2);
+    }
+}
+
+template <int Octaves, typename Real, int Dimensions>
+Real PerlinNoise::generateNoise(Real x, Real y, Real z, Real frequency, Real amplitude, Real persistence, Real lacunarity) const {
+    static_assert(Octaves > 0, "generateNoise needs at least one octave");
+    Real noiseValue = 0;
+    Real maxAmplitude = 0;
+    for (int i = 0; i < Octaves; ++i) {
+        noiseValue += amplitude * noise<Real, Dimensions>(x * frequency, y * frequency, z * frequency);
+        maxAmplitude += amplitude;
+        frequency *= lacunarity;
+        amplitude *= persistence;
+    }
+    // Same mapping to -1..1 as generateNoise
+    noiseValue /= maxAmplitude;
+    noiseValue = 2 * noiseValue - 1;
+    return noiseValue * maxAmplitude;
+}
+
 #endif // PERLINNOISE_HPP
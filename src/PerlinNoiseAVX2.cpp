@@ -0,0 +1,97 @@
+// Compiled with -mavx2; only called after PerlinNoise has checked the CPU supports it.
+#include "PerlinNoiseSimd.hpp"
+#include <immintrin.h>
+
+namespace {
+
+// 4 doubles per vector, lane indices in the low 128 bits
+struct Avx2Double {
+    using Scalar = double;
+    using Real = __m256d;
+    using Int = __m128i;
+    static constexpr std::size_t width = 4;
+
+    static Real load(const double* v) { return _mm256_loadu_pd(v); }
+    static void store(double* dst, Real v) { _mm256_storeu_pd(dst, v); }
+    static Real set1(double v) { return _mm256_set1_pd(v); }
+    static Real add(Real a, Real b) { return _mm256_add_pd(a, b); }
+    static Real sub(Real a, Real b) { return _mm256_sub_pd(a, b); }
+    static Real mul(Real a, Real b) { return _mm256_mul_pd(a, b); }
+    static Real div(Real a, Real b) { return _mm256_div_pd(a, b); }
+    static Real floor(Real v) { return _mm256_floor_pd(v); }
+    static Real andr(Real a, Real b) { return _mm256_and_pd(a, b); }
+    static Real xorr(Real a, Real b) { return _mm256_xor_pd(a, b); }
+    static Real select(Real mask, Real a, Real b) { return _mm256_blendv_pd(b, a, mask); }
+    static Int toInt(Real v) { return _mm256_cvttpd_epi32(v); }
+
+    static Int set1i(int v) { return _mm_set1_epi32(v); }
+    static Int addi(Int a, Int b) { return _mm_add_epi32(a, b); }
+    static Int andi(Int a, Int b) { return _mm_and_si128(a, b); }
+
+    static __m256i widen(Int v) { return _mm256_cvtepi32_epi64(v); }
+    static Real bitToSign(__m256i v) { return _mm256_castsi256_pd(_mm256_slli_epi64(v, 63)); }
+    static Real bitMask(__m256i v, int bit) {
+        __m256i b = _mm256_set1_epi64x(bit);
+        return _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(v, b), b));
+    }
+
+    // One 64-bit gather fetches both neighbours, then the halves are split apart
+    static void gatherPair(const int* table, Int index, Int& first, Int& second) {
+        __m256i pairs = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(table), index, 4);
+        __m256i split = _mm256_permutevar8x32_epi32(pairs, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+        first = _mm256_castsi256_si128(split);
+        second = _mm256_extracti128_si256(split, 1);
+    }
+};
+
+// 8 floats per vector
+struct Avx2Float {
+    using Scalar = float;
+    using Real = __m256;
+    using Int = __m256i;
+    static constexpr std::size_t width = 8;
+
+    static Real load(const float* v) { return _mm256_loadu_ps(v); }
+    static void store(float* dst, Real v) { _mm256_storeu_ps(dst, v); }
+    static Real set1(float v) { return _mm256_set1_ps(v); }
+    static Real add(Real a, Real b) { return _mm256_add_ps(a, b); }
+    static Real sub(Real a, Real b) { return _mm256_sub_ps(a, b); }
+    static Real mul(Real a, Real b) { return _mm256_mul_ps(a, b); }
+    static Real div(Real a, Real b) { return _mm256_div_ps(a, b); }
+    static Real floor(Real v) { return _mm256_floor_ps(v); }
+    static Real andr(Real a, Real b) { return _mm256_and_ps(a, b); }
+    static Real xorr(Real a, Real b) { return _mm256_xor_ps(a, b); }
+    static Real select(Real mask, Real a, Real b) { return _mm256_blendv_ps(b, a, mask); }
+    static Int toInt(Real v) { return _mm256_cvttps_epi32(v); }
+
+    static Int set1i(int v) { return _mm256_set1_epi32(v); }
+    static Int addi(Int a, Int b) { return _mm256_add_epi32(a, b); }
+    static Int andi(Int a, Int b) { return _mm256_and_si256(a, b); }
+
+    static Int widen(Int v) { return v; }
+    static Real bitToSign(Int v) { return _mm256_castsi256_ps(_mm256_slli_epi32(v, 31)); }
+    static Real bitMask(Int v, int bit) {
+        Int b = _mm256_set1_epi32(bit);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(v, b), b));
+    }
+
+    // Two 64-bit gathers (lanes 0-3 and 4-7) fetch both neighbours, then the halves are split apart
+    static void gatherPair(const int* table, Int index, Int& first, Int& second) {
+        const long long* pairTable = reinterpret_cast<const long long*>(table);
+        const __m256i order = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        __m256i low = _mm256_permutevar8x32_epi32(_mm256_i32gather_epi64(pairTable, _mm256_castsi256_si128(index), 4), order);
+        __m256i high = _mm256_permutevar8x32_epi32(_mm256_i32gather_epi64(pairTable, _mm256_extracti128_si256(index, 1), 4), order);
+        first = _mm256_permute2x128_si256(low, high, 0x20);
+        second = _mm256_permute2x128_si256(low, high, 0x31);
+    }
+};
+
+} // namespace
+
+void noiseBatchAVX2(const int* p, const double* x, const double* y, double z, std::size_t count, double* out) {
+    noiseBatchKernel<Avx2Double>(p, x, y, z, count, out);
+}
+
+void noiseBatchAVX2(const int* p, const float* x, const float* y, float z, std::size_t count, float* out) {
+    noiseBatchKernel<Avx2Float>(p, x, y, z, count, out);
+}
@@ -0,0 +1,95 @@
+// Compiled with -msse4.1; only called after PerlinNoise has checked the CPU supports it.
+#include "PerlinNoiseSimd.hpp"
+#include <smmintrin.h>
+
+namespace {
+
+// Integer lane operations shared by both SSE lane types
+struct Sse41Int {
+    using Int = __m128i;
+
+    static Int set1i(int v) { return _mm_set1_epi32(v); }
+    static Int addi(Int a, Int b) { return _mm_add_epi32(a, b); }
+    static Int andi(Int a, Int b) { return _mm_and_si128(a, b); }
+
+    // SSE has no gather, so each lane is looked up on its own
+    static void gatherPair(const int* table, Int index, Int& first, Int& second) {
+        const int* i0 = table + _mm_extract_epi32(index, 0);
+        const int* i1 = table + _mm_extract_epi32(index, 1);
+        const int* i2 = table + _mm_extract_epi32(index, 2);
+        const int* i3 = table + _mm_extract_epi32(index, 3);
+        first = _mm_setr_epi32(i0[0], i1[0], i2[0], i3[0]);
+        second = _mm_setr_epi32(i0[1], i1[1], i2[1], i3[1]);
+    }
+};
+
+// 2 doubles per vector, lane indices in the low 64 bits
+struct Sse41Double : Sse41Int {
+    using Scalar = double;
+    using Real = __m128d;
+    static constexpr std::size_t width = 2;
+
+    static Real load(const double* v) { return _mm_loadu_pd(v); }
+    static void store(double* dst, Real v) { _mm_storeu_pd(dst, v); }
+    static Real set1(double v) { return _mm_set1_pd(v); }
+    static Real add(Real a, Real b) { return _mm_add_pd(a, b); }
+    static Real sub(Real a, Real b) { return _mm_sub_pd(a, b); }
+    static Real mul(Real a, Real b) { return _mm_mul_pd(a, b); }
+    static Real div(Real a, Real b) { return _mm_div_pd(a, b); }
+    static Real floor(Real v) { return _mm_floor_pd(v); }
+    static Real andr(Real a, Real b) { return _mm_and_pd(a, b); }
+    static Real xorr(Real a, Real b) { return _mm_xor_pd(a, b); }
+    static Real select(Real mask, Real a, Real b) { return _mm_blendv_pd(b, a, mask); }
+    static Int toInt(Real v) { return _mm_cvttpd_epi32(v); }
+
+    static Int widen(Int v) { return _mm_cvtepi32_epi64(v); }
+    static Real bitToSign(Int v) { return _mm_castsi128_pd(_mm_slli_epi64(v, 63)); }
+    static Real bitMask(Int v, int bit) {
+        Int b = _mm_set1_epi64x(bit);
+        return _mm_castsi128_pd(_mm_cmpeq_epi64(_mm_and_si128(v, b), b));
+    }
+
+    static void gatherPair(const int* table, Int index, Int& first, Int& second) {
+        const int* i0 = table + _mm_extract_epi32(index, 0);
+        const int* i1 = table + _mm_extract_epi32(index, 1);
+        first = _mm_setr_epi32(i0[0], i1[0], 0, 0);
+        second = _mm_setr_epi32(i0[1], i1[1], 0, 0);
+    }
+};
+
+// 4 floats per vector
+struct Sse41Float : Sse41Int {
+    using Scalar = float;
+    using Real = __m128;
+    static constexpr std::size_t width = 4;
+
+    static Real load(const float* v) { return _mm_loadu_ps(v); }
+    static void store(float* dst, Real v) { _mm_storeu_ps(dst, v); }
+    static Real set1(float v) { return _mm_set1_ps(v); }
+    static Real add(Real a, Real b) { return _mm_add_ps(a, b); }
+    static Real sub(Real a, Real b) { return _mm_sub_ps(a, b); }
+    static Real mul(Real a, Real b) { return _mm_mul_ps(a, b); }
+    static Real div(Real a, Real b) { return _mm_div_ps(a, b); }
+    static Real floor(Real v) { return _mm_floor_ps(v); }
+    static Real andr(Real a, Real b) { return _mm_and_ps(a, b); }
+    static Real xorr(Real a, Real b) { return _mm_xor_ps(a, b); }
+    static Real select(Real mask, Real a, Real b) { return _mm_blendv_ps(b, a, mask); }
+    static Int toInt(Real v) { return _mm_cvttps_epi32(v); }
+
+    static Int widen(Int v) { return v; }
+    static Real bitToSign(Int v) { return _mm_castsi128_ps(_mm_slli_epi32(v, 31)); }
+    static Real bitMask(Int v, int bit) {
+        Int b = _mm_set1_epi32(bit);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(v, b), b));
+    }
+};
+
+} // namespace
+
+void noiseBatchSSE41(const int* p, const double* x, const double* y, double z, std::size_t count, double* out) {
+    noiseBatchKernel<Sse41Double>(p, x, y, z, count, out);
+}
+
+void noiseBatchSSE41(const int* p, const float* x, const float* y, float z, std::size_t count, float* out) {
+    noiseBatchKernel<Sse41Float>(p, x, y, z, count, out);
+}
@@ -0,0 +1,122 @@
+#ifndef PERLINNOISE_SIMD_HPP
+#define PERLINNOISE_SIMD_HPP
+
+#include <cstddef>
+
+// Batch Perlin noise kernels. Each instruction set lives in its own translation unit
+// (PerlinNoiseSSE41.cpp, PerlinNoiseAVX2.cpp) compiled with matching flags; PerlinNoise
+// picks one at runtime. The double kernels do the same operations in the same order as
+// PerlinNoise::noise, so their results are bit-identical to the scalar path.
+
+void noiseBatchSSE41(const int* p, const double* x, const double* y, double z, std::size_t count, double* out);
+void noiseBatchSSE41(const int* p, const float* x, const float* y, float z, std::size_t count, float* out);
+void noiseBatchAVX2(const int* p, const double* x, const double* y, double z, std::size_t count, double* out);
+void noiseBatchAVX2(const int* p, const float* x, const float* y, float z, std::size_t count, float* out);
+
+// Generic kernel, instantiated by the ISA translation units with a lane type V that provides
+// Scalar/Real/Int types, the lane count and the arithmetic, integer and table lookup operations.
+// gatherPair(p, i, a, b) loads a = p[i] and b = p[i + 1] per lane; widen() spreads a hash to the
+// Real lane width for bitMask()/bitToSign().
+template <typename V>
+void noiseBatchKernel(const int* p, const typename V::Scalar* xs, const typename V::Scalar* ys,
+                      typename V::Scalar zs, std::size_t count, typename V::Scalar* out) {
+    using Real = typename V::Real;
+    using Int = typename V::Int;
+    using Scalar = typename V::Scalar;
+
+    const Real one = V::set1(1), half = V::set1(0.5f);
+    const Real six = V::set1(6), fifteen = V::set1(15), ten = V::set1(10);
+    const Int mask255 = V::set1i(255);
+
+    // Fade function, same evaluation order as PerlinNoise::fade
+    auto fade = [&](Real t) {
+        return V::mul(V::mul(V::mul(t, t), t), V::add(V::mul(t, V::sub(V::mul(t, six), fifteen)), ten));
+    };
+    // Linear interpolation, same as PerlinNoise::lerp
+    auto lerp = [](Real t, Real a, Real b) {
+        return V::add(a, V::mul(t, V::sub(b, a)));
+    };
+    // Gradient function. hash & 11 only ever selects rows {0,1,2,3,8,9,10,11} of the gradient
+    // table: bit 0 is the sign, bit 1 picks y over x and bit 3 adds z. The components are 0 or +-1,
+    // so u * x is either x with its sign flipped by bit 0 or a zero carrying the sign of x; doing
+    // that with bit masks gives exactly the products the scalar code computes.
+    const Real signBit = V::set1(-0.0f);
+    auto grad = [&](Int hash, Real x, Real y, Real z) {
+        auto h = V::widen(hash);
+        Real flip = V::bitToSign(h);
+        Real useY = V::bitMask(h, 2);
+        Real useZ = V::bitMask(h, 8);
+        Real ux = V::select(useY, V::andr(x, signBit), V::xorr(x, flip));
+        Real vy = V::select(useY, V::xorr(y, flip), V::andr(y, signBit));
+        Real wz = V::select(useZ, z, V::andr(z, signBit));
+        return V::add(V::add(ux, vy), wz);
+    };
+
+    auto evaluate = [&](const Scalar* xIn, const Scalar* yIn, Scalar* result) {
+        Real x = V::load(xIn);
+        Real y = V::load(yIn);
+        Real z = V::set1(zs);
+
+        Real fx = V::floor(x), fy = V::floor(y), fz = V::floor(z);
+        Int X = V::andi(V::toInt(fx), mask255);
+        Int Y = V::andi(V::toInt(fy), mask255);
+        Int Z = V::andi(V::toInt(fz), mask255);
+
+        x = V::sub(x, fx);
+        y = V::sub(y, fy);
+        z = V::sub(z, fz);
+
+        Real u = fade(x);
+        Real v = fade(y);
+        Real w = fade(z);
+
+        // Hash coordinates of the 8 cube corners. p[i] and p[i + 1] are always needed
+        // together, so they come from a single paired lookup.
+        Int pX, pX1, pA, pA1, pB, pB1;
+        V::gatherPair(p, X, pX, pX1);
+        Int A = V::addi(pX, Y);
+        Int B = V::addi(pX1, Y);
+        V::gatherPair(p, A, pA, pA1);
+        V::gatherPair(p, B, pB, pB1);
+        Int AA = V::addi(pA, Z);
+        Int AB = V::addi(pA1, Z);
+        Int BA = V::addi(pB, Z);
+        Int BB = V::addi(pB1, Z);
+
+        Int hAA, hAA1, hAB, hAB1, hBA, hBA1, hBB, hBB1;
+        V::gatherPair(p, AA, hAA, hAA1);
+        V::gatherPair(p, AB, hAB, hAB1);
+        V::gatherPair(p, BA, hBA, hBA1);
+        V::gatherPair(p, BB, hBB, hBB1);
+
+        Real x1 = V::sub(x, one), y1 = V::sub(y, one), z1 = V::sub(z, one);
+
+        // Add blended results from 8 corners of cube
+        Real res = lerp(w,
+            lerp(v, lerp(u, grad(hAA, x, y, z), grad(hBA, x1, y, z)),
+                    lerp(u, grad(hAB, x, y1, z), grad(hBB, x1, y1, z))),
+            lerp(v, lerp(u, grad(hAA1, x, y, z1), grad(hBA1, x1, y, z1)),
+                    lerp(u, grad(hAB1, x, y1, z1), grad(hBB1, x1, y1, z1))));
+        V::store(result, V::mul(V::add(res, one), half)); // Same as / 2, halving is exact
+    };
+
+    // The last partial block is padded to a full vector through small local buffers
+    Scalar xTail[V::width] = {}, yTail[V::width] = {}, outTail[V::width];
+    for (std::size_t i = 0; i < count; i += V::width) {
+        const std::size_t n = count - i < V::width ? count - i : V::width;
+        if (n == V::width) {
+            evaluate(xs + i, ys + i, out + i);
+            continue;
+        }
+        for (std::size_t j = 0; j < n; ++j) {
+            xTail[j] = xs[i + j];
+            yTail[j] = ys[i + j];
+        }
+        evaluate(xTail, yTail, outTail);
+        for (std::size_t j = 0; j < n; ++j) {
+            out[i + j] = outTail[j];
+        }
+    }
+}
+
+#endif // PERLINNOISE_SIMD_HPP
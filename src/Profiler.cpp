@@ -0,0 +1,125 @@
+#include "Profiler.hpp"
+#include <fstream>
+#include <iostream>
+
+std::atomic<long long> Profiler::allocatedBytes{0};
+
+Profiler::Profiler()
+    : enabled(false) {
+}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::setEnabled(bool enabled_) {
+    enabled = enabled_;
+}
+
+bool Profiler::isEnabled() const {
+    return enabled;
+}
+
+void Profiler::recordAllocation(std::size_t bytes) {
+    allocatedBytes.fetch_add(static_cast<long long>(bytes), std::memory_order_relaxed);
+}
+
+long long Profiler::getAllocatedBytes() {
+    return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+// Find a phase by name, creating it on first use (mutex must be held)
+Profiler::Phase& Profiler::findPhase(const std::string& name) {
+    for (auto& phase : phases) {
+        if (phase.name == name) return phase;
+    }
+    phases.push_back(Phase(name));
+    return phases.back();
+}
+
+void Profiler::addPhase(const std::string& name, double wallMs, double cpuMs, long long bytesAllocated) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Phase& phase = findPhase(name);
+    phase.calls++;
+    phase.wallMs += wallMs;
+    phase.cpuMs += cpuMs;
+    phase.bytesAllocated += bytesAllocated;
+}
+
+void Profiler::addCounter(const std::string& phaseName, const std::string& counter, long long value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    findPhase(phaseName).counters[counter] += value;
+}
+
+std::vector<Profiler::Phase> Profiler::getPhases() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return phases;
+}
+
+void Profiler::writeJson(std::ostream& out) const {
+    std::vector<Phase> snapshot = getPhases();
+    out << "{\n  \"phases\": [";
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        const Phase& phase = snapshot[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"name\": \"" << phase.name << "\", \"calls\": " << phase.calls
+            << ", \"wall_ms\": " << phase.wallMs << ", \"cpu_ms\": " << phase.cpuMs
+            << ", \"bytes_allocated\": " << phase.bytesAllocated << ", \"counters\": {";
+        bool first = true;
+        for (const auto& [name, value] : phase.counters) {
+            out << (first ? "" : ", ") << '"' << name << "\": " << value;
+            first = false;
+        }
+        out << "}}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void Profiler::writeCsv(std::ostream& out) const {
+    out << "phase,calls,wall_ms,cpu_ms,bytes_allocated,counters\n";
+    for (const Phase& phase : getPhases()) {
+        out << phase.name << ',' << phase.calls << ',' << phase.wallMs << ',' << phase.cpuMs << ','
+            << phase.bytesAllocated << ',';
+        bool first = true;
+        for (const auto& [name, value] : phase.counters) {
+            out << (first ? "" : ";") << name << '=' << value;
+            first = false;
+        }
+        out << '\n';
+    }
+}
+
+bool Profiler::writeReport(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not write profile report: " << path << '\n';
+        return false;
+    }
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0) {
+        writeCsv(file);
+    } else {
+        writeJson(file);
+    }
+    return true;
+}
+
+ScopedTimer::ScopedTimer(const char* phase_)
+    : phase(phase_), active(Profiler::instance().isEnabled()) {
+    if (!active) return;
+    wallStart = std::chrono::steady_clock::now();
+    cpuStart = std::clock();
+    bytesStart = Profiler::getAllocatedBytes();
+}
+
+ScopedTimer::~ScopedTimer() {
+    if (!active) return;
+    std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - wallStart;
+    double cpuMs = 1000.0 * static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    Profiler::instance().addPhase(phase, wall.count(), cpuMs, Profiler::getAllocatedBytes() - bytesStart);
+}
+
+void ScopedTimer::addCounter(const char* name, long long value) {
+    if (!active) return;
+    Profiler::instance().addCounter(phase, name, value);
+}
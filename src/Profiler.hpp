@@ -0,0 +1,77 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Collects wall time, CPU time, allocated bytes and counters per named phase.
+// Does nothing until enabled (--profile), so the timers can stay in the hot paths.
+// CPU time and allocated bytes are process-wide over the phase's wall interval (std::clock), so
+// they include the worker threads a phase uses, but also any other phase running at the same time.
+class Profiler {
+public:
+    struct Phase {
+        explicit Phase(const std::string& name_ = std::string()) : name(name_) {}
+
+        std::string name;
+        long long calls = 0;
+        double wallMs = 0.0;
+        double cpuMs = 0.0; // Process CPU time while the phase ran, all threads
+        long long bytesAllocated = 0;
+        std::map<std::string, long long> counters;
+    };
+
+    static Profiler& instance();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    // Accumulate one run of a phase; counters are summed over calls
+    void addPhase(const std::string& name, double wallMs, double cpuMs, long long bytesAllocated);
+    void addCounter(const std::string& phase, const std::string& counter, long long value);
+
+    std::vector<Phase> getPhases() const;
+    void writeJson(std::ostream& out) const;
+    void writeCsv(std::ostream& out) const;
+    bool writeReport(const std::string& path) const; // CSV for *.csv, JSON otherwise
+
+    // Fed by the operator new of AllocationCounter.cpp in the executables that link it; 0 otherwise
+    static void recordAllocation(std::size_t bytes);
+    static long long getAllocatedBytes();
+
+private:
+    Profiler();
+    Phase& findPhase(const std::string& name);
+
+    mutable std::mutex mutex;
+    std::vector<Phase> phases; // In order of first use
+    bool enabled;
+    static std::atomic<long long> allocatedBytes;
+};
+
+// Times the enclosing scope as one call of the named phase
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* phase);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    void addCounter(const char* name, long long value);
+
+private:
+    const char* phase;
+    bool active;
+    std::chrono::steady_clock::time_point wallStart;
+    std::clock_t cpuStart;
+    long long bytesStart;
+};
+
+#endif // PROFILER_HPP
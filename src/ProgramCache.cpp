@@ -0,0 +1,150 @@
+#include "ProgramCache.hpp"
+#include "Hash.hpp"
+#include "shader.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+std::string glString(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+} // namespace
+
+ProgramCache::ProgramCache(const std::string& directory_)
+    : directory(directory_), loadedCount(0), compiledCount(0), supported(-1) {
+}
+
+const int& ProgramCache::getLoadedCount() const {
+    return loadedCount;
+}
+
+const int& ProgramCache::getCompiledCount() const {
+    return compiledCount;
+}
+
+bool ProgramCache::available() {
+    if (supported < 0) {
+        GLint formats = 0;
+        if (!directory.empty() && GLEW_ARB_get_program_binary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        supported = formats > 0 ? 1 : 0;
+        if (!directory.empty() && !supported) {
+            std::cerr << "The GL driver cannot save program binaries, compiling the shaders every run" << '\n';
+        }
+    }
+    return supported == 1;
+}
+
+GLuint ProgramCache::createProgramFromFiles(const std::string& vertexFilePath, const std::string& fragmentFilePath) {
+    if (!available()) {
+        ++compiledCount;
+        return createShaderProgramFromFile(vertexFilePath, fragmentFilePath);
+    }
+
+    const std::string vertexSource = readShaderSource(vertexFilePath);
+    const std::string fragmentSource = readShaderSource(fragmentFilePath);
+    if (vertexSource.empty() || fragmentSource.empty()) return 0;
+
+    uint64_t key = fnvOffsetBasis;
+    hashString(key, std::to_string(programCacheVersion));
+    hashString(key, vertexSource);
+    hashString(key, fragmentSource);
+    hashString(key, glString(GL_VENDOR));
+    hashString(key, glString(GL_RENDERER));
+    hashString(key, glString(GL_VERSION));
+    char name[32];
+    std::snprintf(name, sizeof(name), "program-%016llx.bin", static_cast<unsigned long long>(key));
+    const std::string path = (std::filesystem::path(directory) / name).string();
+
+    GLuint program = loadBinary(path, key);
+    if (program != 0) {
+        ++loadedCount;
+        return program;
+    }
+
+    // Missing, stale or rejected: build from the sources already read, then store the result
+    program = glCreateProgram();
+    if (program == 0) {
+        std::cerr << "ERROR::SHADER::PROGRAM::CREATION_FAILED: Could not create shader program." << '\n';
+        return 0;
+    }
+    GLuint vertexShader = loadShader(vertexSource.c_str(), GL_VERTEX_SHADER);
+    GLuint fragmentShader = loadShader(fragmentSource.c_str(), GL_FRAGMENT_SHADER);
+    GL_CHECK(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    GL_CHECK(glAttachShader(program, vertexShader));
+    GL_CHECK(glAttachShader(program, fragmentShader));
+    GL_CHECK(glLinkProgram(program));
+    checkProgramLinkErrors(program);
+    GL_CHECK(glDeleteShader(vertexShader));
+    GL_CHECK(glDeleteShader(fragmentShader));
+    ++compiledCount;
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked == GL_TRUE) saveBinary(program, path, key);
+    return program;
+}
+
+GLuint ProgramCache::loadBinary(const std::string& path, uint64_t key) const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return 0;
+    ProgramCacheHeader header = {};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return 0;
+    if (std::memcmp(header.magic, "TRNPROGB", sizeof(header.magic)) != 0 || header.version != programCacheVersion ||
+        header.key != key || header.length == 0 || header.length > (1ull << 30)) {
+        return 0;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size()))) return 0;
+
+    // A driver that no longer accepts the binary fails the link, which is not a GL error
+    GLuint program = glCreateProgram();
+    if (program == 0) return 0;
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    glGetError(); // An unknown format is GL_INVALID_ENUM; either way the program is compiled instead
+    if (linked != GL_TRUE) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::saveBinary(GLuint program, const std::string& path, uint64_t key) const {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    GL_CHECK(glGetProgramBinary(program, length, &length, &format, binary.data()));
+
+    ProgramCacheHeader header = {};
+    std::memcpy(header.magic, "TRNPROGB", sizeof(header.magic));
+    header.version = programCacheVersion;
+    header.format = format;
+    header.key = key;
+    header.length = static_cast<uint64_t>(length);
+
+    // Written aside and renamed, so a concurrent run never reads half a binary
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file) {
+            std::filesystem::remove(temporary, error);
+            std::cerr << "Could not write the program binary " << path << '\n';
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) std::filesystem::remove(temporary, error);
+}
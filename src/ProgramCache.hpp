@@ -0,0 +1,45 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <GL/glew.h>
+
+// Program binary file written by ProgramCache, in native byte order: the header is followed by
+// length bytes of driver-specific binary in the given format.
+struct ProgramCacheHeader {
+    char magic[8];  // "TRNPROGB"
+    uint32_t version;
+    uint32_t format; // binaryFormat of glGetProgramBinary
+    uint64_t key;    // The hash the file is named after
+    uint64_t length;
+};
+
+const uint32_t programCacheVersion = 1;
+
+// Linked shader programs kept on disk with glGetProgramBinary, so later runs skip compiling and
+// linking. A file is named after an FNV-1a hash of both shader sources and the GL vendor, renderer
+// and version strings, so an edited shader or a driver update gives a new file. A binary the driver
+// rejects is compiled from source again and its file rewritten. Without ARB_get_program_binary, or
+// when the driver offers no binary format, every program is compiled.
+class ProgramCache {
+public:
+    explicit ProgramCache(const std::string& directory); // Empty: compile everything, write nothing
+
+    // Like createShaderProgramFromFile; needs a current GL context
+    GLuint createProgramFromFiles(const std::string& vertexFilePath, const std::string& fragmentFilePath);
+
+    const int& getLoadedCount() const;   // Programs restored from a binary
+    const int& getCompiledCount() const; // Programs built from source
+
+private:
+    bool available();
+    GLuint loadBinary(const std::string& path, uint64_t key) const; // 0 if missing, stale or rejected
+    void saveBinary(GLuint program, const std::string& path, uint64_t key) const;
+
+    std::string directory;
+    int loadedCount, compiledCount;
+    int supported; // -1 until available() has asked the driver
+};
+
+#endif // PROGRAM_CACHE_HPP
@@ -0,0 +1,49 @@
+#include "RenderState.hpp"
+#include "shader.hpp"
+
+FrameUniforms::FrameUniforms()
+    : buffer(0) {
+}
+
+FrameUniforms::~FrameUniforms() {
+    if (buffer != 0) glDeleteBuffers(1, &buffer);
+}
+
+void FrameUniforms::init() {
+    if (!GLEW_ARB_uniform_buffer_object && !GLEW_VERSION_3_1) return;
+    GL_CHECK(glGenBuffers(1, &buffer));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, buffer));
+    GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+    GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, frameDataBinding, buffer));
+}
+
+void FrameUniforms::attach(GLuint program) {
+    if (buffer != 0) {
+        const GLuint blockIndex = glGetUniformBlockIndex(program, "FrameData");
+        if (blockIndex != GL_INVALID_INDEX) {
+            GL_CHECK(glUniformBlockBinding(program, blockIndex, frameDataBinding));
+            return;
+        }
+    }
+    fallbackPrograms.push_back({program, glGetUniformLocation(program, "view"), glGetUniformLocation(program, "projection"),
+                                glGetUniformLocation(program, "viewProjection")});
+}
+
+void FrameUniforms::update(const FrameData& data) {
+    if (buffer != 0) {
+        GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, buffer));
+        GL_CHECK(glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data));
+        GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+    }
+    for (const FallbackProgram& fallback : fallbackPrograms) {
+        GL_CHECK(glUseProgram(fallback.program));
+        glUniformMatrix4fv(fallback.view, 1, GL_FALSE, data.view);
+        glUniformMatrix4fv(fallback.projection, 1, GL_FALSE, data.projection);
+        glUniformMatrix4fv(fallback.viewProjection, 1, GL_FALSE, data.viewProjection);
+    }
+}
+
+bool FrameUniforms::usesBuffer() const {
+    return buffer != 0;
+}
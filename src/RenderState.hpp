@@ -0,0 +1,46 @@
+#ifndef RENDER_STATE_HPP
+#define RENDER_STATE_HPP
+
+#include <vector>
+#include <GL/glew.h>
+
+// Per-frame matrices shared by the terrain and cube shaders, laid out as their FrameData
+// uniform block (std140: three column-major mat4s)
+struct FrameData {
+    GLfloat view[16];
+    GLfloat projection[16];
+    GLfloat viewProjection[16]; // projection * view
+};
+
+// Uniform buffer binding point of the FrameData block
+const GLuint frameDataBinding = 0;
+
+// Owns the FrameData uniform buffer: one buffer update per frame reaches every attached program,
+// with no uniform lookups or program switches. Without ARB_uniform_buffer_object the shaders
+// declare plain uniforms instead, and update sets them program by program through locations
+// looked up in attach.
+class FrameUniforms {
+public:
+    FrameUniforms();
+    ~FrameUniforms();
+
+    FrameUniforms(const FrameUniforms&) = delete;
+    FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+    void init(); // Needs a current GL context
+    void attach(GLuint program); // After linking; the program's shaders declare FrameData
+    // Upload data. The fallback path leaves the last attached program in use.
+    void update(const FrameData& data);
+    bool usesBuffer() const;
+
+private:
+    struct FallbackProgram {
+        GLuint program;
+        GLint view, projection, viewProjection;
+    };
+
+    GLuint buffer;
+    std::vector<FallbackProgram> fallbackPrograms;
+};
+
+#endif // RENDER_STATE_HPP
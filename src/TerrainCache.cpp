@@ -0,0 +1,32 @@
+#include "TerrainCache.hpp"
+#include <cstdio>
+#include <filesystem>
+#include "Hash.hpp"
+
+uint64_t hashTerrainKey(const TerrainKey& key) {
+    // Field by field, so struct padding never reaches the hash
+    uint64_t hash = fnvOffsetBasis;
+    hashValue(hash, terrainCacheVersion);
+    hashValue(hash, key.frequency);
+    hashValue(hash, key.amplitude);
+    hashValue(hash, key.persistence);
+    hashValue(hash, key.lacunarity);
+    hashValue(hash, key.octave);
+    hashValue(hash, key.width);
+    hashValue(hash, key.step);
+    hashValue(hash, key.seed);
+    // Only when on, so CPU-generated, uneroded terrain keeps the file names of older runs
+    if (key.erosion > 0) {
+        hashValue(hash, erosionModelVersion);
+        hashValue(hash, key.erosion);
+    }
+    if (key.gpuNoise) hashValue(hash, key.gpuNoise);
+    if (key.floatNoise) hashValue(hash, key.floatNoise);
+    return hash;
+}
+
+std::string terrainCachePath(const std::string& directory, const TerrainKey& key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "terrain-%016llx.bin", static_cast<unsigned long long>(hashTerrainKey(key)));
+    return (std::filesystem::path(directory) / name).string();
+}
@@ -0,0 +1,38 @@
+#ifndef TERRAIN_CACHE_HPP
+#define TERRAIN_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+
+// Everything that determines the generated terrain of a fixed-size world. width and step are the
+// TerrainMesh values (after the --width/--lod conversion in main).
+struct TerrainKey {
+    double frequency = 0.0, amplitude = 0.0, persistence = 0.0, lacunarity = 0.0;
+    int octave = 0, width = 0, step = 0, seed = 0;
+    int erosion = 0; // Erosion iterations
+    bool gpuNoise = false; // Noise from GpuNoise, whose single-precision heights differ from the CPU ones
+    bool floatNoise = false; // Noise summed by the float kernel (TerrainMesh::setFloatNoise)
+};
+
+// Heightfield cache file, written by TerrainMesh::saveCache. Native byte order, meant to be mapped:
+// the header is followed by columns * rows scaled heights, then columns * rows normals (3 floats each).
+struct TerrainCacheHeader {
+    char magic[8];  // "TRNCACHE"
+    uint32_t version;
+    uint32_t columns, rows;
+    uint32_t reserved;
+    uint64_t key;   // hashTerrainKey of the parameters it was generated with
+    float minHeight, maxHeight; // Noise range before scaling
+    float waterLevel, heightDif_low, heightDif_high, waterdepthMax;
+};
+
+const uint32_t terrainCacheVersion = 1;
+// Part of the key of eroded terrain; bump it when erodeHeightField or the default ErosionSettings change
+const uint32_t erosionModelVersion = 2;
+
+// FNV-1a over the parameters and the cache format version; any change in either gives a new file name
+uint64_t hashTerrainKey(const TerrainKey& key);
+// directory/terrain-<16 hex digits>.bin
+std::string terrainCachePath(const std::string& directory, const TerrainKey& key);
+
+#endif // TERRAIN_CACHE_HPP
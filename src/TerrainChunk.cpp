@@ -0,0 +1,143 @@
+#include "TerrainChunk.hpp"
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include "math.hpp"
+
+ChunkGenerator::ChunkGenerator(const WorldSettings& settings_, int seed)
+    : settings(settings_), perlinNoise(seed) {
+    computeWorldLevels();
+}
+
+const WorldSettings& ChunkGenerator::getSettings() const {
+    return settings;
+}
+
+float ChunkGenerator::getChunkWorldSize() const {
+    return settings.chunkCells * settings.step * 0.1f;
+}
+
+// Unscaled terrain height at a grid position, same formula as TerrainMesh::generateBaseTerrain
+float ChunkGenerator::sampleHeight(int x, int z) const {
+    float nx = static_cast<float>(x) / settings.width;
+    float nz = static_cast<float>(z) / settings.width;
+    return perlinNoise.generateNoise(nx, nz, 0.5, settings.frequency, settings.amplitude, settings.octave,
+                                     settings.persistence, settings.lacunarity) + 1.5;
+}
+
+// There is no finite map to take min/max from, so sample the central width x width area
+// (what the fixed-size terrain would cover) once and derive the levels from it.
+void ChunkGenerator::computeWorldLevels() {
+    const int sampleStep = std::max(settings.step, settings.width / 128);
+    float minheight = std::numeric_limits<float>::max();
+    float maxheight = std::numeric_limits<float>::lowest();
+    for (int z = -settings.width / 2; z < settings.width / 2; z += sampleStep) {
+        for (int x = -settings.width / 2; x < settings.width / 2; x += sampleStep) {
+            float height = sampleHeight(x, z);
+            minheight = std::min(minheight, height);
+            maxheight = std::max(maxheight, height);
+        }
+    }
+
+    const float scale = settings.width / 60.0f;
+    float waterLevel = (maxheight - minheight) * 0.35f + minheight;
+    settings.heightDif_low = (minheight + ((maxheight - minheight) * 0.4f)) * scale;
+    settings.heightDif_high = settings.heightDif_low * 0.1f;
+    settings.waterdepthMax = (waterLevel - minheight) * scale;
+    settings.waterLevel = waterLevel * scale;
+}
+
+ChunkMesh ChunkGenerator::generateChunk(int chunkX, int chunkZ) const {
+    const int cells = settings.chunkCells;
+    const int step = settings.step;
+    const int columns = cells + 1;   // Vertices per side; the last row/column is shared with the neighbour
+    const int samples = columns + 2; // One extra sample on every side for the normals
+    const int originX = chunkX * cells * step;
+    const int originZ = chunkZ * cells * step;
+    const float scale = settings.width / 60.0f;
+
+    ChunkMesh mesh;
+    mesh.chunkX = chunkX;
+    mesh.chunkZ = chunkZ;
+
+    // Scaled heights including the one-sample apron, a row at a time through the batch noise kernel
+    std::vector<float> heights(static_cast<size_t>(samples) * samples);
+    std::vector<double> nx(samples), nz(samples), rowNoise(samples);
+    for (int i = 0; i < samples; ++i) {
+        nx[i] = static_cast<float>(originX + (i - 1) * step) / settings.width;
+    }
+    for (int row = 0; row < samples; ++row) {
+        std::fill(nz.begin(), nz.end(), static_cast<float>(originZ + (row - 1) * step) / settings.width);
+        perlinNoise.generateNoiseBatch(nx.data(), nz.data(), 0.5, samples, rowNoise.data(), settings.frequency,
+                                       settings.amplitude, settings.octave, settings.persistence, settings.lacunarity);
+        for (int i = 0; i < samples; ++i) {
+            float height = rowNoise[i] + 1.5;
+            heights[static_cast<size_t>(row) * samples + i] = height * scale;
+        }
+    }
+    auto heightAt = [&](int column, int row) { return heights[static_cast<size_t>(row + 1) * samples + column + 1]; };
+
+    mesh.minHeight = std::numeric_limits<float>::max();
+    mesh.maxHeight = std::numeric_limits<float>::lowest();
+    mesh.columns = columns;
+    mesh.heights.reserve(static_cast<size_t>(columns) * columns);
+    mesh.vertices.reserve((static_cast<size_t>(columns) * columns + 4) * 9);
+    const float spacing = step * 0.1f;
+
+    // Terrain vertices, normals from central differences so they match across chunk edges
+    for (int row = 0; row < columns; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            int x = originX + column * step;
+            int z = originZ + row * step;
+            float height = heightAt(column, row);
+            Vec normal = normalize(Vec{heightAt(column - 1, row) - heightAt(column + 1, row), 2.0f * spacing,
+                                       heightAt(column, row - 1) - heightAt(column, row + 1)});
+            mesh.vertices.insert(mesh.vertices.end(), {
+                x * 0.1f, height, z * 0.1f,
+                normal.x, normal.y, normal.z,
+                (static_cast<float>(x) + settings.width / 2) / settings.width,
+                (static_cast<float>(z) + settings.width / 2) / settings.width,
+                height});
+            mesh.heights.push_back(height);
+            mesh.minHeight = std::min(mesh.minHeight, height);
+            mesh.maxHeight = std::max(mesh.maxHeight, height);
+        }
+    }
+
+    // Water quad over the chunk, in the same winding as the grid
+    mesh.waterFirstVertex = static_cast<unsigned int>(columns * columns);
+    for (const auto& corner : {std::pair{0, 0}, std::pair{cells, 0}, std::pair{cells, cells}, std::pair{0, cells}}) {
+        int x = originX + corner.first * step;
+        int z = originZ + corner.second * step;
+        mesh.vertices.insert(mesh.vertices.end(), {
+            x * 0.1f, settings.waterLevel, z * 0.1f,
+            0.0f, 1.0f, 0.0f,
+            (static_cast<float>(x) + settings.width / 2) / settings.width,
+            (static_cast<float>(z) + settings.width / 2) / settings.width,
+            settings.waterLevel});
+    }
+
+    // Terrain indices, same triangles as TerrainMesh; as strips, one per row with the same winding and diagonal
+    if (settings.triangleStrips) {
+        mesh.indices.reserve(static_cast<size_t>(cells) * (2 * columns + 1));
+        for (int y = 0; y < cells; ++y) {
+            if (y > 0) mesh.indices.push_back(chunkRestartIndex);
+            for (int x = 0; x < columns; ++x) {
+                mesh.indices.push_back(static_cast<uint16_t>((y + 1) * columns + x));
+                mesh.indices.push_back(static_cast<uint16_t>(y * columns + x));
+            }
+        }
+    } else {
+        mesh.indices.reserve(static_cast<size_t>(cells) * cells * 6);
+        for (int y = 0; y < cells; ++y) {
+            for (int x = 0; x < cells; ++x) {
+                uint16_t start = static_cast<uint16_t>(y * columns + x);
+                uint16_t below = static_cast<uint16_t>(start + columns);
+                mesh.indices.insert(mesh.indices.end(), {
+                    start, static_cast<uint16_t>(start + 1), static_cast<uint16_t>(below + 1),
+                    static_cast<uint16_t>(below + 1), below, start});
+            }
+        }
+    }
+    return mesh;
+}
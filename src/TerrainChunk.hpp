@@ -0,0 +1,54 @@
+#ifndef TERRAIN_CHUNK_HPP
+#define TERRAIN_CHUNK_HPP
+
+#include <cstdint>
+#include <vector>
+#include "PerlinNoise.hpp"
+
+// Settings shared by every chunk of a streamed world. width and step mean the same as in
+// TerrainMesh (noise/height scale and grid spacing); the levels are fixed once for the whole world.
+struct WorldSettings {
+    int width = 0;
+    int step = 1;
+    int chunkCells = 64; // Grid cells along one side of a chunk; (chunkCells + 1)^2 + 4 vertices must fit 16-bit indices
+    bool triangleStrips = false; // Index the terrain as strips with primitive restart (chunkRestartIndex)
+    double frequency = 3.0, amplitude = 0.5, persistence = 0.5, lacunarity = 2.0;
+    int octave = 10;
+    float waterLevel = 0.0f, heightDif_low = 0.0f, heightDif_high = 0.0f, waterdepthMax = 0.0f;
+};
+
+// CPU mesh for one chunk, in the same 9-float vertex layout as TerrainMesh
+// (x, y, z, nx, ny, nz, u, v, height): the terrain grid followed by a water quad (triangle fan).
+struct ChunkMesh {
+    int chunkX = 0, chunkZ = 0;
+    std::vector<float> vertices;
+    std::vector<uint16_t> indices;     // Terrain only
+    unsigned int waterFirstVertex = 0;
+    std::vector<float> heights;        // Scaled terrain heights of the grid, for the water pass height map
+    int columns = 0;                   // Grid vertices along one side
+    float minHeight = 0.0f, maxHeight = 0.0f;
+};
+
+// Separates the rows of a chunk's triangle strips
+const uint16_t chunkRestartIndex = 0xFFFF;
+
+// Generates chunks of an unbounded terrain. Noise is sampled at world-space grid positions,
+// so neighbouring chunks produce identical heights and normals along their shared edge.
+// generateChunk is const and can run on several threads at once.
+class ChunkGenerator {
+public:
+    ChunkGenerator(const WorldSettings& settings, int seed);
+
+    ChunkMesh generateChunk(int chunkX, int chunkZ) const;
+    float getChunkWorldSize() const; // Side length of a chunk in world units
+    const WorldSettings& getSettings() const;
+
+private:
+    void computeWorldLevels();
+    float sampleHeight(int x, int z) const;
+
+    WorldSettings settings;
+    PerlinNoise perlinNoise;
+};
+
+#endif // TERRAIN_CHUNK_HPP
@@ -1,170 +1,184 @@
 #include "TerrainGenerate.hpp"
-#include <cmath>
-#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <iostream>
-#include "PerlinNoise.hpp"
-#include "math.hpp"
+#include <memory>
+#include "GpuNoise.hpp"
 #include "shader.hpp"
+#include "Profiler.hpp"
 
 Terrain::Terrain()
-    : minheight(std::numeric_limits<float>::max()), maxheight(std::numeric_limits<float>::min()), 
-    perlinNoise(0){
+    : VAO(0), VBO(0), EBO(0), heightTexture(0), heightMapTransformLoc(-1), heightMapTransform{1.0f, 1.0f, 0.0f, 0.0f},
+      waterFirstVertex(0), compactVertices(false), indexMode(TerrainLod::IndexMode::Triangles), threadPool(nullptr), mappedVertices(nullptr),
+      cacheKey(0), gpuNoise(nullptr), uploadPrepared(false) {
     }
 
 Terrain::~Terrain() {
+    waitForGeneration();
+    // Nothing was uploaded (e.g. headless run), so there is no GL context to talk to
+    if (VAO == 0 && VBO == 0) return;
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
     glDeleteVertexArrays(1, &VAO);
+    glDeleteTextures(1, &heightTexture);
 }
 
 // Initialize the terrain
 void Terrain::init(const int& width_, const int& step_, const int& seed_){
-    width = width_;
-    height = width_;
-    step = step_;
-    perlinNoise.initialize(seed_);
-    vertices.reserve(width * height * 12 / (step * step));
-    indices.reserve(width * height * 12 / (step * step));
-    height_map.reserve(width * height / (step * step)); 
+    mesh.init(width_, step_, seed_);
+}
+
+// Share a worker pool with the CPU generation stages
+void Terrain::setThreadPool(ThreadPool* pool) {
+    threadPool = pool;
+    mesh.setThreadPool(pool);
+}
+
+// Upload CompactVertex data instead of the 9-float layout
+void Terrain::setCompactVertices(bool compact) {
+    compactVertices = compact;
+}
+
+// Draw the patches as triangle lists or as strips with primitive restart
+void Terrain::setIndexMode(TerrainLod::IndexMode mode) {
+    indexMode = mode;
+}
+
+// Load the terrain from this heightfield cache file instead of generating it, when it matches key
+void Terrain::setCache(const std::string& path, uint64_t key) {
+    cachePath = path;
+    cacheKey = key;
+}
+
+void Terrain::setHeightMapFiles(std::shared_ptr<const HeightMapFile> importFile, const std::string& exportPath) {
+    heightMapImport = std::move(importFile);
+    heightMapExportPath = exportPath;
+}
+
+void Terrain::setGpuNoise(GpuNoise* noise) {
+    gpuNoise = noise;
+}
+
+void Terrain::setNoiseLayers(NoiseLayerCache* layers) {
+    mesh.setNoiseLayers(layers);
+}
+
+void Terrain::setErosion(const ErosionSettings& settings) {
+    mesh.setErosion(settings);
+}
+
+void Terrain::setFloatNoise(bool enabled) {
+    mesh.setFloatNoise(enabled);
 }
 
 //Generate vertices and indices for the terrain
 void Terrain::generateBaseTerrain(double frequency, int octave, double amplitude, double persistence, double lacunarity) {
-    int i = 0;
-
-    std::vector<float> height_array;
-    height_array.reserve(width * height / (step * step));
-
-    // Generate the terrain height values
-    for (int z = -height / 2; z < height / 2; z += step) {
-        for (int x = -width / 2; x < width / 2; x += step) {
-            float nx = static_cast<float>(x) / width;
-            float nz = static_cast<float>(z) / height;
-            float height = perlinNoise.generateNoise(nx, nz, 0.5, frequency, amplitude, octave, persistence, lacunarity) + 1.5;
-            height_array.push_back(height);
-            if (height < minheight) minheight = height;
-            if (height > maxheight) maxheight = height;
-        }
-    }
+    mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+}
+
+// Set the water level; the water itself is a quad drawn over the height map
+void Terrain::generateWater(){
+    mesh.generateWater();
+}
+
+// Generate the normals and overall buffer for the terrain
+void Terrain::generateTerrainNormals(){
+    mesh.generateTerrainNormals();
+}
 
-    waterLevel = ((maxheight - minheight) * 0.35f + minheight); // Set the water level
-    heightDif_low = (minheight + ((maxheight - minheight)* 0.4f)) * width / 60.0f ; // Set the height difference lower limit
-    heightDif_high = heightDif_low * 0.1 ; // Set the height difference upper limit
-    waterdepthMax = (waterLevel - minheight) * width / 60.0f;
-    
-    i = 0;
-    for (int z = -height / 2; z < height / 2; z += step) {
-        for (int x = -width / 2; x < width / 2; x += step) {
-            // Adjust the height of the terrain based on the terrain shape
-            height_array[i] = perlinNoise.adjustNoiseForTerrainShape(height_array[i], x, z, width, height, step, waterLevel);
-
-            float scaledheight = height_array[i++] * width / 60.0f;
-            vertices.push_back(x * 0.1f); // Scale x
-            vertices.push_back(scaledheight); // Scale height
-            vertices.push_back(z * 0.1f); // Scale z
-
-            // Store the height for later use
-            height_map.push_back(scaledheight);
-            
-            // Generate texture coordinates
-            vertices.push_back((static_cast<float>(x) + width / 2) / width);
-            vertices.push_back((static_cast<float>(z) + height / 2) / height);
-
-            // Add the height for the terrain, used to determine if the water should be displayed
-            vertices.push_back(scaledheight);
+// Run the three generation stages (or the cache load), and the CPU side of initTerrain, on the thread
+// pool while the caller keeps rendering frames.
+// The vertex buffer is allocated and mapped here, on the GL thread, and the normal pass writes each
+// finished row band straight into it, so generation and the transfer overlap and initTerrain has no
+// bulk copy left to do. Persistent buffer storage is used where available (GL 4.4 / ARB_buffer_storage),
+// otherwise a mapped glBufferData buffer, which is fine as long as it is not drawn before it is unmapped.
+void Terrain::startGeneration(double frequency, int octave, double amplitude, double persistence, double lacunarity) {
+    if (!compactVertices) {
+        const size_t vertexCount = static_cast<size_t>(mesh.getWidth() / mesh.getStep()) * (mesh.getHeight() / mesh.getStep()) + 4;
+        const GLsizeiptr bytes = static_cast<GLsizeiptr>(vertexCount * 9 * sizeof(GLfloat));
+        GL_CHECK(glGenBuffers(1, &VBO));
+        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, VBO));
+        if (GLEW_ARB_buffer_storage) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            GL_CHECK(glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags));
+            mappedVertices = static_cast<GLfloat*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags));
+        } else {
+            GL_CHECK(glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW));
+            mappedVertices = static_cast<GLfloat*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
         }
-    }
-    height_array.shrink_to_fit();
-
-    // Generate the terrain indices
-    for (int y = 0; y < height / step - 1; ++y) {
-        for (int x = 0; x < width / step - 1; ++x) {
-            int start = y * (width / step) + x;
-            indices.push_back(start);
-            indices.push_back(start + 1);
-            indices.push_back(start + width / step + 1);
-            indices.push_back(start + width / step + 1);
-            indices.push_back(start + width / step);
-            indices.push_back(start);
+        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        if (!mappedVertices) {
+            std::cerr << "Could not map the terrain vertex buffer, uploading it after generation instead" << '\n';
+            glDeleteBuffers(1, &VBO);
+            VBO = 0;
         }
+        mesh.setVertexOutput(mappedVertices);
     }
-}
 
-// Generate vertices and indices for the water plane
-void Terrain::generateWater(){
-    int j = 0;
-    waterLevel = waterLevel * width / 60.0f;
-
-    // Generate the water plane vertices, following the same pattern as the terrain
-    for (int z = -height / 2; z < height / 2; z += step) {
-        for (int x = -width / 2; x < width / 2; x += step) {
-            vertices.push_back(x * 0.1f); // scale x
-            vertices.push_back(waterLevel); // fixed waterlevel
-            vertices.push_back(z * 0.1f); // scale z
-
-            // add texture coordinates
-            vertices.push_back((static_cast<float>(x) + width / 2) / width);
-            vertices.push_back((static_cast<float>(z) + height / 2) / height);
-
-            // add the height for the terrain, used to determine if the water should be displayed
-            vertices.push_back(height_map[j++]);
+    auto done = std::make_shared<std::promise<void>>();
+    generation = done->get_future();
+    // The noise pass needs the GL thread, and takes milliseconds, so it runs before the task is queued.
+    // The cache is looked up first, which is far cheaper, and a hit skips the pass.
+    std::vector<float> gpuHeights;
+    bool cached = false;
+    if (gpuNoise && !heightMapImport) {
+        cached = !cachePath.empty() && mesh.loadCache(cachePath, cacheKey);
+        if (!cached) {
+            gpuNoise->generate(mesh.getNoise(), mesh.getWidth(), mesh.getStep(), frequency, octave, amplitude, persistence, lacunarity, gpuHeights);
         }
     }
-    height_map.shrink_to_fit();
-
-    // Generate the water plane indices
-    int waterOffset = (height / step) * (width / step);
-    for (int y = 0; y < height / step - 1; ++y) {
-        for (int x = 0; x < width / step - 1; ++x) {
-            int start = waterOffset + y * (width / step) + x;
-            indices.push_back(start);
-            indices.push_back(start + 1);
-            indices.push_back(start + width / step + 1);
-            indices.push_back(start + width / step + 1);
-            indices.push_back(start + width / step);
-            indices.push_back(start);
+
+    auto task = [this, done, cached, frequency, octave, amplitude, persistence, lacunarity, gpuHeights = std::move(gpuHeights)]() mutable {
+        try {
+            if (heightMapImport) {
+                mesh.importHeightMap(*heightMapImport);
+                mesh.generateWater();
+                mesh.generateTerrainNormals();
+            } else if (!cached && (cachePath.empty() || gpuNoise || !mesh.loadCache(cachePath, cacheKey))) {
+                if (!gpuHeights.empty()) {
+                    mesh.generateBaseTerrainFromNoise(std::move(gpuHeights));
+                } else {
+                    mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+                }
+                mesh.generateWater();
+                mesh.generateTerrainNormals();
+                if (!cachePath.empty() && !mesh.saveCache(cachePath, cacheKey)) {
+                    std::cerr << "Could not write terrain cache: " << cachePath << '\n';
+                }
+            }
+            if (!heightMapExportPath.empty()) mesh.exportHeightMap(heightMapExportPath);
+            prepareUpload();
+            done->set_value();
+        } catch (...) {
+            done->set_exception(std::current_exception());
         }
+    };
+    if (threadPool) {
+        threadPool->submit(task);
+    } else {
+        task();
     }
 }
 
-// Generate the normals and overall buffer for the terrain
-void Terrain::generateTerrainNormals(){
-    // Calculate the normals for the terrain
-    std::vector<GLfloat> normals;
-    computeVertexNormals(vertices, indices, normals);
-
-    // Combine the vertices and normals into a single array
-    for (size_t i = 0; i < vertices.size() / 6; ++i) {
-        verticesWithNormals.push_back(vertices[i * 6]);     // x
-        verticesWithNormals.push_back(vertices[i * 6 + 1]); // y
-        verticesWithNormals.push_back(vertices[i * 6 + 2]); // z
-        verticesWithNormals.push_back(normals[i * 6]);      // nx
-        verticesWithNormals.push_back(normals[i * 6 + 1]);  // ny
-        verticesWithNormals.push_back(normals[i * 6 + 2]);  // nz
-        verticesWithNormals.push_back(vertices[i * 6 + 3]); // u
-        verticesWithNormals.push_back(vertices[i * 6 + 4]); // v
-        verticesWithNormals.push_back(vertices[i * 6 + 5]); // height
-    }
-    vertices.shrink_to_fit();
+// Upload the rest of the terrain once the background generation is done. Returns false while it is
+// still running, true once the terrain can be drawn.
+bool Terrain::finishGeneration(const GLuint& shaderProgram) {
+    if (VAO != 0) return true;
+    if (!generation.valid() || generation.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+    generation.get();
+    initTerrain(shaderProgram);
+    return true;
 }
 
+// Block until a running background generation is done
+void Terrain::waitForGeneration() {
+    if (generation.valid()) generation.wait();
+}
 
-// Initialize the terrain
-void Terrain::initTerrain(const GLuint& shaderProgram){
-    // Generate and bind the terrain vertices and indices
-    GL_CHECK(glGenVertexArrays(1, &VAO));
-    GL_CHECK(glBindVertexArray(VAO));
-
-    GL_CHECK(glGenBuffers(1, &VBO));
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, VBO));
-    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, verticesWithNormals.size() * sizeof(GLfloat), verticesWithNormals.data(), GL_STATIC_DRAW));
-    std::vector<GLfloat>().swap(verticesWithNormals);
-
-    GL_CHECK(glGenBuffers(1, &EBO));
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO));
-    GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW));
-    std::vector<GLuint>().swap(indices);
 
+// Point the terrain shader attributes at the interleaved 9-float vertex layout of the bound VBO
+void setupTerrainVertexAttributes(const GLuint& shaderProgram) {
     GLint posAttrib = glGetAttribLocation(shaderProgram, "aPos");
     GL_CHECK(glEnableVertexAttribArray(posAttrib));
     GL_CHECK(glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)0));
@@ -180,7 +194,170 @@ void Terrain::initTerrain(const GLuint& shaderProgram){
     GLint heightAttrib = glGetAttribLocation(shaderProgram, "aHeight");
     GL_CHECK(glEnableVertexAttribArray(heightAttrib));
     GL_CHECK(glVertexAttribPointer(heightAttrib, 1, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(8 * sizeof(GLfloat))));
+}
+
+// Single-channel float texture of a columns x rows height grid, for the water pass
+GLuint createHeightTexture(const float* heights, int columns, int rows) {
+    // Work on the height map's own unit, so the textures bound for the terrain pass stay in place
+    GLuint texture;
+    GL_CHECK(glActiveTexture(GL_TEXTURE0 + heightMapTextureUnit));
+    GL_CHECK(glGenTextures(1, &texture));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, columns, rows, 0, GL_RED, GL_FLOAT, heights));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+    GL_CHECK(glActiveTexture(GL_TEXTURE0));
+    return texture;
+}
+
+// Point the compact vertex shader attributes at CompactVertex data and pass it the grid layout
+static void setupCompactVertexAttributes(const GLuint& shaderProgram, const TerrainMesh& mesh) {
+    GLint gridAttrib = glGetAttribLocation(shaderProgram, "aGrid");
+    GL_CHECK(glEnableVertexAttribArray(gridAttrib));
+    GL_CHECK(glVertexAttribPointer(gridAttrib, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(CompactVertex), (GLvoid*)offsetof(CompactVertex, column)));
+
+    GLint heightAttrib = glGetAttribLocation(shaderProgram, "aHeight");
+    GL_CHECK(glEnableVertexAttribArray(heightAttrib));
+    GL_CHECK(glVertexAttribPointer(heightAttrib, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (GLvoid*)offsetof(CompactVertex, height)));
+
+    GLint normalAttrib = glGetAttribLocation(shaderProgram, "aNormal");
+    GL_CHECK(glEnableVertexAttribArray(normalAttrib));
+    GL_CHECK(glVertexAttribPointer(normalAttrib, 2, GL_BYTE, GL_TRUE, sizeof(CompactVertex), (GLvoid*)offsetof(CompactVertex, normal)));
+
+    const int columns = mesh.getWidth() / mesh.getStep();
+    const int rows = mesh.getHeight() / mesh.getStep();
+    glUseProgram(shaderProgram);
+    glUniform2f(glGetUniformLocation(shaderProgram, "gridOrigin"), -mesh.getWidth() / 2 * 0.1f, -mesh.getHeight() / 2 * 0.1f);
+    glUniform1f(glGetUniformLocation(shaderProgram, "gridSpacing"), mesh.getStep() * 0.1f);
+    glUniform2f(glGetUniformLocation(shaderProgram, "gridSize"), static_cast<float>(columns), static_cast<float>(rows));
+    glUniform2f(glGetUniformLocation(shaderProgram, "heightRange"), mesh.getCompactHeightMin(), mesh.getCompactHeightMax());
+}
+
+// CPU work of initTerrain that needs no GL context: patch indices and compact vertices
+void Terrain::prepareUpload() {
+    lod.build(mesh.getWidth() / mesh.getStep(), mesh.getHeight() / mesh.getStep(), mesh.getVerticesWithNormals(), indexMode);
+    if (compactVertices) {
+        mesh.encodeCompactVertices();
+    }
+    uploadPrepared = true;
+}
+
+// Initialize the terrain
+void Terrain::initTerrain(const GLuint& shaderProgram){
+    if (!uploadPrepared) {
+        prepareUpload();
+    }
+    ScopedTimer timer("gpu_upload");
+    const int columns = mesh.getWidth() / mesh.getStep();
+    const int rows = mesh.getHeight() / mesh.getStep();
+    const size_t vertexBytes = compactVertices ? mesh.getCompactVertices().size() * sizeof(CompactVertex)
+                                               : mesh.getVerticesWithNormals().size() * sizeof(GLfloat);
+    const void* vertexData = compactVertices ? static_cast<const void*>(mesh.getCompactVertices().data())
+                                             : static_cast<const void*>(mesh.getVerticesWithNormals().data());
+
+    // The water quad spans the grid at the water level and follows the terrain vertices in the VBO
+    waterFirstVertex = columns * rows;
+    std::vector<float> waterQuad;
+    std::vector<CompactVertex> compactWaterQuad;
+    const int corners[4][2] = {{0, 0}, {columns - 1, 0}, {columns - 1, rows - 1}, {0, rows - 1}}; // Same winding as the grid
+    for (const auto& corner : corners) {
+        int x = -mesh.getWidth() / 2 + corner[0] * mesh.getStep();
+        int z = -mesh.getHeight() / 2 + corner[1] * mesh.getStep();
+        waterQuad.insert(waterQuad.end(), {
+            x * 0.1f, mesh.getWaterLevel(), z * 0.1f,
+            0.0f, 1.0f, 0.0f,
+            (static_cast<float>(x) + mesh.getWidth() / 2) / mesh.getWidth(),
+            (static_cast<float>(z) + mesh.getHeight() / 2) / mesh.getHeight(),
+            mesh.getWaterLevel()});
+        compactWaterQuad.push_back(CompactVertex{static_cast<uint16_t>(corner[0]), static_cast<uint16_t>(corner[1]), 0, {0, 0}});
+    }
+    const size_t waterBytes = compactVertices ? compactWaterQuad.size() * sizeof(CompactVertex) : waterQuad.size() * sizeof(GLfloat);
+    const void* waterData = compactVertices ? static_cast<const void*>(compactWaterQuad.data()) : static_cast<const void*>(waterQuad.data());
+
+    timer.addCounter("bytes_uploaded", static_cast<long long>((mappedVertices ? 0 : vertexBytes) + waterBytes + lod.getIndexBytes() +
+                                                              mesh.getHeightMap().size() * sizeof(GLfloat)));
+
+    // Generate and bind the terrain vertices and indices
+    GL_CHECK(glGenVertexArrays(1, &VAO));
+    GL_CHECK(glBindVertexArray(VAO));
+
+    if (mappedVertices) {
+        // The grid was streamed in by generateTerrainNormals; only the water quad is left
+        std::copy(waterQuad.begin(), waterQuad.end(), mappedVertices + static_cast<size_t>(waterFirstVertex) * 9);
+        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, VBO));
+        GL_CHECK(glUnmapBuffer(GL_ARRAY_BUFFER));
+        mappedVertices = nullptr;
+        mesh.setVertexOutput(nullptr);
+    } else {
+        GL_CHECK(glGenBuffers(1, &VBO));
+        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, VBO));
+        GL_CHECK(glBufferData(GL_ARRAY_BUFFER, vertexBytes + waterBytes, nullptr, GL_STATIC_DRAW));
+        GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, vertexBytes, vertexData));
+        GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, vertexBytes, waterBytes, waterData));
+    }
+
+    GL_CHECK(glGenBuffers(1, &EBO));
+    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO));
+    GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, lod.getIndexBytes(), lod.getIndexData(), GL_STATIC_DRAW));
+
+    if (compactVertices) {
+        setupCompactVertexAttributes(shaderProgram, mesh);
+    } else {
+        setupTerrainVertexAttributes(shaderProgram);
+    }
     GL_CHECK(glBindVertexArray(0));
+
+    // Terrain heights for the water pass, sampled at texel centres so they match the grid vertices
+    heightTexture = createHeightTexture(mesh.getHeightMap().data(), columns, rows);
+    heightMapTransformLoc = glGetUniformLocation(shaderProgram, "heightMapTransform");
+    heightMapTransform[0] = 1.0f;
+    heightMapTransform[1] = 1.0f;
+    heightMapTransform[2] = 0.5f / columns;
+    heightMapTransform[3] = 0.5f / rows;
+    mesh.releaseBuffers();
+}
+
+// Pick the level of every patch for this frame's camera position and drop the patches outside the view
+void Terrain::updateLod(const Vec& cameraPos, float lodDistance, const Frustum& frustum) {
+    ScopedTimer timer("patch_select");
+    lod.selectLevels(cameraPos, lodDistance, frustum);
+    timer.addCounter("patches_drawn", lod.getVisiblePatchCount());
+    timer.addCounter("patches_culled", lod.getPatchCount() - lod.getVisiblePatchCount());
+    timer.addCounter("triangles", static_cast<long long>(lod.getTriangleCount()));
+}
+
+void Terrain::drawTerrain() const {
+    const bool strips = lod.getIndexMode() == TerrainLod::IndexMode::Strips;
+    const GLenum mode = strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+    const GLenum type = lod.getIndexSize() == sizeof(GLushort) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    if (strips) {
+        // The restart index is compared before the base vertex is added
+        GL_CHECK(glEnable(GL_PRIMITIVE_RESTART));
+        GL_CHECK(glPrimitiveRestartIndex(lod.getRestartIndex()));
+    }
+    GL_CHECK(glBindVertexArray(VAO));
+    for (const TerrainLod::Draw& draw : lod.getDraws()) {
+        GL_CHECK(glDrawElementsBaseVertex(mode, draw.indexCount, type, (GLvoid*)(static_cast<size_t>(draw.indexOffset) * lod.getIndexSize()), draw.baseVertex));
+    }
+    GL_CHECK(glBindVertexArray(0));
+    if (strips) {
+        GL_CHECK(glDisable(GL_PRIMITIVE_RESTART));
+    }
+}
+
+// One quad at the water level; the fragment shader reads the ground height from the height map
+void Terrain::drawWater() const {
+    GL_CHECK(glActiveTexture(GL_TEXTURE0 + heightMapTextureUnit));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, heightTexture));
+    GL_CHECK(glUniform4fv(heightMapTransformLoc, 1, heightMapTransform));
+    GL_CHECK(glBindVertexArray(VAO));
+    GL_CHECK(glDrawArrays(GL_TRIANGLE_FAN, waterFirstVertex, 4));
+    GL_CHECK(glBindVertexArray(0));
+    GL_CHECK(glActiveTexture(GL_TEXTURE0));
 }
 
 const GLuint& Terrain::getVAO() const {
@@ -188,29 +365,33 @@ const GLuint& Terrain::getVAO() const {
 }
 
 const float& Terrain::getWaterLevel() const {
-    return waterLevel;
+    return mesh.getWaterLevel();
 }
 
 const float& Terrain::getWaterdepthMax() const {
-    return waterdepthMax;
+    return mesh.getWaterdepthMax();
 }
 
 const float& Terrain::getHeightDif_low() const {
-    return heightDif_low;
+    return mesh.getHeightDif_low();
 }
 
 const float& Terrain::getHeightDif_high() const {
-    return heightDif_high;
+    return mesh.getHeightDif_high();
 }
 
 const int& Terrain::getWidth() const {
-    return width;
+    return mesh.getWidth();
 }
 
 const int& Terrain::getHeight() const {
-    return height;
+    return mesh.getHeight();
 }
 
 const int& Terrain::getStep() const {
-    return step;
+    return mesh.getStep();
+}
+
+unsigned long long Terrain::getDrawnTriangleCount() const {
+    return lod.getTriangleCount();
 }
\ No newline at end of file
@@ -1,9 +1,21 @@
 #ifndef TERRAIN_H
 #define TERRAIN_H
 
+#include <future>
+#include <memory>
+#include <string>
 #include <vector>
 #include <GL/glew.h>
-#include "PerlinNoise.hpp"  
+#include "TerrainMesh.hpp"
+#include "TerrainLod.hpp"
+
+// Texture unit the water pass reads the terrain heights from (uniform "heightMap")
+const int heightMapTextureUnit = 2;
+
+class GpuNoise;
+
+void setupTerrainVertexAttributes(const GLuint& shaderProgram);
+GLuint createHeightTexture(const float* heights, int columns, int rows);
 
 class Terrain {
 public:
@@ -11,10 +23,28 @@ public:
     ~Terrain();
 
     void init(const int& width, const int& step, const int& seed);
+    void setThreadPool(ThreadPool* pool);
+    void setCompactVertices(bool compact); // Needs the compact vertex shader; set before initTerrain
+    void setIndexMode(TerrainLod::IndexMode mode); // Set before initTerrain
+    void setCache(const std::string& path, uint64_t key); // Used by startGeneration; empty path disables it
+    // Also used by startGeneration: take the heights from importFile instead of the noise (when set),
+    // and write them to exportPath once generated (when not empty)
+    void setHeightMapFiles(std::shared_ptr<const HeightMapFile> importFile, const std::string& exportPath);
+    void setGpuNoise(GpuNoise* noise); // Evaluate the noise of startGeneration on the GPU; not owned, nullptr for the CPU
+    void setNoiseLayers(NoiseLayerCache* layers); // See TerrainMesh::setNoiseLayers
+    void setErosion(const ErosionSettings& settings); // See TerrainMesh::setErosion
+    void setFloatNoise(bool enabled); // See TerrainMesh::setFloatNoise
     void generateBaseTerrain(double frequency, int octave, double amplitude, double persistence, double lacunarity);
     void generateWater();
     void generateTerrainNormals();
     void initTerrain(const GLuint& shaderProgram);
+    // Background alternative to the three generate calls and initTerrain; all on the GL thread
+    void startGeneration(double frequency, int octave, double amplitude, double persistence, double lacunarity);
+    bool finishGeneration(const GLuint& shaderProgram);
+    void waitForGeneration();
+    void updateLod(const Vec& cameraPos, float lodDistance, const Frustum& frustum);
+    void drawTerrain() const;
+    void drawWater() const;
     const GLuint& getVAO() const;
     const float& getWaterLevel() const;
     const float& getWaterdepthMax() const;
@@ -23,16 +53,29 @@ public:
     const int& getWidth() const;
     const int& getHeight() const;
     const int& getStep() const;
+    unsigned long long getDrawnTriangleCount() const; // Terrain triangles drawTerrain draws, after updateLod
 
 private:
-    std::vector<GLfloat> vertices, verticesWithNormals;
-    std::vector<GLuint> indices;
+    void prepareUpload();
+
+    TerrainMesh mesh; // CPU-side generation, no GL dependency
+    TerrainLod lod;   // Per-patch level of detail; its index lists are what the EBO holds
     GLuint VAO, VBO, EBO;
-    int width, height, step;
-    float minheight, maxheight;
-    PerlinNoise perlinNoise;
-    float waterLevel, heightDif_low, heightDif_high, waterdepthMax;
-    std::vector<float> height_map;
+    GLuint heightTexture;          // Terrain heights for the water pass
+    GLint heightMapTransformLoc;
+    GLfloat heightMapTransform[4]; // Maps TexCoord to texel centres of heightTexture
+    GLint waterFirstVertex;        // The water quad follows the terrain vertices
+    bool compactVertices;
+    TerrainLod::IndexMode indexMode;
+    ThreadPool* threadPool;          // Runs startGeneration; not owned
+    std::future<void> generation;    // Set by startGeneration
+    GLfloat* mappedVertices;         // VBO mapping the normal pass writes into, until initTerrain
+    std::string cachePath;           // Heightfield cache file, loaded or written by startGeneration
+    uint64_t cacheKey;
+    std::shared_ptr<const HeightMapFile> heightMapImport;
+    std::string heightMapExportPath;
+    GpuNoise* gpuNoise;
+    bool uploadPrepared; // prepareUpload already ran on the generation task
 };
 
 #endif // TERRAIN_H
@@ -0,0 +1,329 @@
+#include "TerrainLod.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Edges of a patch that face a coarser neighbour
+enum EdgeMask { EdgeZMin = 1, EdgeXMax = 2, EdgeZMax = 4, EdgeXMin = 8 };
+const int edgeMaskCount = 16;
+
+// Vertex positions kept along one side of a patch at the given stride; the far edge is always kept
+std::vector<int> stridePositions(int cells, int stride) {
+    std::vector<int> positions;
+    for (int position = 0; position < cells; position += stride) {
+        positions.push_back(position);
+    }
+    positions.push_back(cells);
+    return positions;
+}
+
+// Vertices of one patch at a stride, relative to the patch origin. On edges in edgeMask every odd
+// vertex is moved onto the previous even one, which matches the neighbour's grid at twice the stride.
+struct PatchGrid {
+    PatchGrid(int cellsX, int cellsZ, int stride, int edgeMask_, int columns_)
+        : xs(stridePositions(cellsX, stride)), zs(stridePositions(cellsZ, stride)),
+          lastX(static_cast<int>(xs.size()) - 1), lastZ(static_cast<int>(zs.size()) - 1), edgeMask(edgeMask_), columns(columns_) {
+    }
+
+    unsigned int vertexAt(int xi, int zi) const {
+        int x = xs[xi];
+        int z = zs[zi];
+        bool oddX = (xi & 1) && xi != lastX;
+        bool oddZ = (zi & 1) && zi != lastZ;
+        if (oddX && ((zi == 0 && (edgeMask & EdgeZMin)) || (zi == lastZ && (edgeMask & EdgeZMax)))) x = xs[xi - 1];
+        if (oddZ && ((xi == 0 && (edgeMask & EdgeXMin)) || (xi == lastX && (edgeMask & EdgeXMax)))) z = zs[zi - 1];
+        return static_cast<unsigned int>(z * columns + x);
+    }
+
+    std::vector<int> xs, zs;
+    int lastX, lastZ, edgeMask, columns;
+};
+
+bool degenerate(unsigned int a, unsigned int b, unsigned int c) {
+    return a == b || b == c || c == a;
+}
+
+} // namespace
+
+TerrainLod::TerrainLod()
+    : columns(0), rows(0), patchesX(0), patchesZ(0), shapeCells{{0, 0}, {0, 0}}, patchWorldSize(1.0f), indexMode(IndexMode::Triangles),
+      triangleCount(0), visiblePatchCount(0) {
+}
+
+void TerrainLod::build(int columns_, int rows_, const std::vector<float>& verticesWithNormals, IndexMode mode) {
+    columns = columns_;
+    rows = rows_;
+    indexMode = mode;
+    const int cellsX = columns - 1;
+    const int cellsZ = rows - 1;
+    patchesX = (cellsX + patchCells - 1) / patchCells;
+    patchesZ = (cellsZ + patchCells - 1) / patchCells;
+    shapeCells[0][0] = shapeCells[1][0] = patchCells;
+    shapeCells[0][1] = cellsX % patchCells;
+    shapeCells[1][1] = cellsZ % patchCells;
+    patchWorldSize = (verticesWithNormals[9] - verticesWithNormals[0]) * patchCells;
+
+    // Patch bounds from the terrain vertices, for the distance to the camera and for culling
+    patches.clear();
+    patches.reserve(static_cast<size_t>(patchesX) * patchesZ);
+    for (int pz = 0; pz < patchesZ; ++pz) {
+        for (int px = 0; px < patchesX; ++px) {
+            Patch patch;
+            patch.x0 = px * patchCells;
+            patch.z0 = pz * patchCells;
+            patch.shape = (cellsX - patch.x0 < patchCells ? 1 : 0) | (cellsZ - patch.z0 < patchCells ? 2 : 0);
+            patch.boundsMin = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+            patch.boundsMax = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+            const int xEnd = std::min(patch.x0 + patchCells, cellsX);
+            const int zEnd = std::min(patch.z0 + patchCells, cellsZ);
+            for (int z = patch.z0; z <= zEnd; ++z) {
+                for (int x = patch.x0; x <= xEnd; ++x) {
+                    const float* vertex = &verticesWithNormals[(static_cast<size_t>(z) * columns + x) * 9];
+                    patch.boundsMin = {std::min(patch.boundsMin.x, vertex[0]), std::min(patch.boundsMin.y, vertex[1]), std::min(patch.boundsMin.z, vertex[2])};
+                    patch.boundsMax = {std::max(patch.boundsMax.x, vertex[0]), std::max(patch.boundsMax.y, vertex[1]), std::max(patch.boundsMax.z, vertex[2])};
+                }
+            }
+            patch.level = 0;
+            patch.visible = true;
+            patches.push_back(patch);
+        }
+    }
+
+    nodes.clear();
+    buildNode(0, 0, patchesX, patchesZ);
+
+    // Index lists for every shape that occurs, at every level and edge mask
+    indices.clear();
+    shortIndices.clear();
+    ranges.assign(4 * (maxLevel + 1) * edgeMaskCount, Range{0, 0, 0});
+    for (int shape = 0; shape < 4; ++shape) {
+        int shapeX = shapeCells[0][shape & 1];
+        int shapeZ = shapeCells[1][(shape >> 1) & 1];
+        if (shapeX == 0 || shapeZ == 0) continue;
+        for (int level = 0; level <= maxLevel; ++level) {
+            for (int edgeMask = 0; edgeMask < edgeMaskCount; ++edgeMask) {
+                Range& range = rangeFor(shape, level, edgeMask);
+                range.offset = static_cast<unsigned int>(indices.size());
+                range.triangles = indexMode == IndexMode::Strips ? appendPatchStrips(shapeX, shapeZ, 1 << level, edgeMask)
+                                                                 : appendPatchIndices(shapeX, shapeZ, 1 << level, edgeMask);
+                range.count = static_cast<unsigned int>(indices.size()) - range.offset;
+            }
+        }
+    }
+    packIndices();
+}
+
+// Use 16-bit indices when the largest index of a patch and the restart index both fit
+void TerrainLod::packIndices() {
+    const long long largest = static_cast<long long>(patchCells) * columns + patchCells;
+    if (largest >= 0xFFFF) return;
+    const unsigned int restart = getRestartIndex(); // Still the 32-bit one here
+    shortIndices.reserve(indices.size());
+    for (unsigned int index : indices) {
+        shortIndices.push_back(static_cast<uint16_t>(index == restart ? 0xFFFF : index));
+    }
+    std::vector<unsigned int>().swap(indices);
+}
+
+// Build the subtree for a rectangle of patches, returning its node index
+int TerrainLod::buildNode(int px0, int pz0, int px1, int pz1) {
+    const int index = static_cast<int>(nodes.size());
+    nodes.push_back(QuadNode{px0, pz0, px1, pz1, {0, 0, 0}, {0, 0, 0}, {-1, -1, -1, -1}});
+
+    if (px1 - px0 == 1 && pz1 - pz0 == 1) {
+        const Patch& patch = patches[static_cast<size_t>(pz0) * patchesX + px0];
+        nodes[index].boundsMin = patch.boundsMin;
+        nodes[index].boundsMax = patch.boundsMax;
+        return index;
+    }
+
+    // Split the longer sides in half; a side one patch long is not split
+    const int pxMid = px1 - px0 > 1 ? (px0 + px1) / 2 : px1;
+    const int pzMid = pz1 - pz0 > 1 ? (pz0 + pz1) / 2 : pz1;
+    const int quadrants[4][4] = {{px0, pz0, pxMid, pzMid}, {pxMid, pz0, px1, pzMid}, {px0, pzMid, pxMid, pz1}, {pxMid, pzMid, px1, pz1}};
+    Vec boundsMin = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    Vec boundsMax = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (int i = 0; i < 4; ++i) {
+        const int* q = quadrants[i];
+        if (q[0] == q[2] || q[1] == q[3]) continue;
+        int child = buildNode(q[0], q[1], q[2], q[3]);
+        nodes[index].children[i] = child; // nodes may have grown, so index again
+        boundsMin = {std::min(boundsMin.x, nodes[child].boundsMin.x), std::min(boundsMin.y, nodes[child].boundsMin.y), std::min(boundsMin.z, nodes[child].boundsMin.z)};
+        boundsMax = {std::max(boundsMax.x, nodes[child].boundsMax.x), std::max(boundsMax.y, nodes[child].boundsMax.y), std::max(boundsMax.z, nodes[child].boundsMax.z)};
+    }
+    nodes[index].boundsMin = boundsMin;
+    nodes[index].boundsMax = boundsMax;
+    return index;
+}
+
+// Mark the patches of a node visible; nodes fully inside the frustum skip the tests below them
+void TerrainLod::cullNode(int index, const Frustum& frustum) {
+    const QuadNode& node = nodes[index];
+    FrustumTest test = testBoxInFrustum(frustum, node.boundsMin, node.boundsMax);
+    if (test == FrustumTest::Outside) return;
+    if (test == FrustumTest::Inside || (node.px1 - node.px0 == 1 && node.pz1 - node.pz0 == 1)) {
+        markVisible(node);
+        return;
+    }
+    for (int child : node.children) {
+        if (child >= 0) cullNode(child, frustum);
+    }
+}
+
+void TerrainLod::markVisible(const QuadNode& node) {
+    for (int pz = node.pz0; pz < node.pz1; ++pz) {
+        for (int px = node.px0; px < node.px1; ++px) {
+            patches[static_cast<size_t>(pz) * patchesX + px].visible = true;
+        }
+    }
+}
+
+TerrainLod::Range& TerrainLod::rangeFor(int shape, int level, int edgeMask) {
+    return ranges[(shape * (maxLevel + 1) + level) * edgeMaskCount + edgeMask];
+}
+
+// Triangles of one patch at the given stride, in the same winding as the full-detail grid.
+// The triangles that collapse on stitched edges are dropped.
+unsigned int TerrainLod::appendPatchIndices(int cellsX, int cellsZ, int stride, int edgeMask) {
+    const PatchGrid grid(cellsX, cellsZ, stride, edgeMask, columns);
+    const size_t first = indices.size();
+    auto addTriangle = [&](unsigned int a, unsigned int b, unsigned int c) {
+        if (degenerate(a, b, c)) return;
+        indices.insert(indices.end(), {a, b, c});
+    };
+
+    for (int zi = 0; zi < grid.lastZ; ++zi) {
+        for (int xi = 0; xi < grid.lastX; ++xi) {
+            unsigned int a = grid.vertexAt(xi, zi);
+            unsigned int b = grid.vertexAt(xi + 1, zi);
+            unsigned int c = grid.vertexAt(xi + 1, zi + 1);
+            unsigned int d = grid.vertexAt(xi, zi + 1);
+            addTriangle(a, b, c);
+            addTriangle(c, d, a);
+        }
+    }
+    return static_cast<unsigned int>(indices.size() - first) / 3;
+}
+
+// The same triangles as appendPatchIndices, as one strip per row: (x, z + 1), (x, z) for each column,
+// which keeps the winding and the diagonal of the triangle list. Triangles that collapse on stitched
+// edges stay in the strip (the GPU skips zero-area triangles) so the winding of the rest is unchanged.
+unsigned int TerrainLod::appendPatchStrips(int cellsX, int cellsZ, int stride, int edgeMask) {
+    const PatchGrid grid(cellsX, cellsZ, stride, edgeMask, columns);
+    const unsigned int restart = getRestartIndex();
+    unsigned int triangles = 0;
+
+    for (int zi = 0; zi < grid.lastZ; ++zi) {
+        if (zi > 0) indices.push_back(restart);
+        const size_t rowStart = indices.size();
+        for (int xi = 0; xi <= grid.lastX; ++xi) {
+            indices.push_back(grid.vertexAt(xi, zi + 1));
+            indices.push_back(grid.vertexAt(xi, zi));
+        }
+        for (size_t i = rowStart + 2; i < indices.size(); ++i) {
+            if (!degenerate(indices[i - 2], indices[i - 1], indices[i])) ++triangles;
+        }
+    }
+    return triangles;
+}
+
+void TerrainLod::selectLevels(const Vec& cameraPos, float lodDistance, const Frustum& frustum) {
+    const float threshold = lodDistance * patchWorldSize;
+    for (Patch& patch : patches) {
+        // Distance from the camera to the closest point of the patch bounds
+        float dx = std::max({patch.boundsMin.x - cameraPos.x, 0.0f, cameraPos.x - patch.boundsMax.x});
+        float dy = std::max({patch.boundsMin.y - cameraPos.y, 0.0f, cameraPos.y - patch.boundsMax.y});
+        float dz = std::max({patch.boundsMin.z - cameraPos.z, 0.0f, cameraPos.z - patch.boundsMax.z});
+        float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        if (threshold <= 0.0f || distance < threshold) {
+            patch.level = 0;
+        } else {
+            patch.level = std::min(maxLevel, 1 + static_cast<int>(std::log2(distance / threshold)));
+        }
+    }
+
+    // Neighbours may differ by one level at most, since the edge stitching only covers that case.
+    // Only ever lowers levels, so it settles after a few passes.
+    auto levelAt = [&](int px, int pz) { return patches[static_cast<size_t>(pz) * patchesX + px].level; };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int pz = 0; pz < patchesZ; ++pz) {
+            for (int px = 0; px < patchesX; ++px) {
+                int& level = patches[static_cast<size_t>(pz) * patchesX + px].level;
+                int limit = level;
+                if (px > 0) limit = std::min(limit, levelAt(px - 1, pz) + 1);
+                if (px + 1 < patchesX) limit = std::min(limit, levelAt(px + 1, pz) + 1);
+                if (pz > 0) limit = std::min(limit, levelAt(px, pz - 1) + 1);
+                if (pz + 1 < patchesZ) limit = std::min(limit, levelAt(px, pz + 1) + 1);
+                if (limit < level) {
+                    level = limit;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Culled patches still took part in the level selection above, so the visible ones stitch to them correctly
+    for (Patch& patch : patches) {
+        patch.visible = false;
+    }
+    cullNode(0, frustum);
+
+    draws.clear();
+    triangleCount = 0;
+    visiblePatchCount = 0;
+    for (int pz = 0; pz < patchesZ; ++pz) {
+        for (int px = 0; px < patchesX; ++px) {
+            const Patch& patch = patches[static_cast<size_t>(pz) * patchesX + px];
+            if (!patch.visible) continue;
+            ++visiblePatchCount;
+            int edgeMask = 0;
+            if (pz > 0 && levelAt(px, pz - 1) > patch.level) edgeMask |= EdgeZMin;
+            if (px + 1 < patchesX && levelAt(px + 1, pz) > patch.level) edgeMask |= EdgeXMax;
+            if (pz + 1 < patchesZ && levelAt(px, pz + 1) > patch.level) edgeMask |= EdgeZMax;
+            if (px > 0 && levelAt(px - 1, pz) > patch.level) edgeMask |= EdgeXMin;
+            const Range& range = rangeFor(patch.shape, patch.level, edgeMask);
+            draws.push_back({range.offset, range.count, static_cast<unsigned int>(patch.z0 * columns + patch.x0)});
+            triangleCount += range.triangles;
+        }
+    }
+}
+
+const void* TerrainLod::getIndexData() const {
+    return shortIndices.empty() ? static_cast<const void*>(indices.data()) : static_cast<const void*>(shortIndices.data());
+}
+
+size_t TerrainLod::getIndexBytes() const {
+    return shortIndices.empty() ? indices.size() * sizeof(unsigned int) : shortIndices.size() * sizeof(uint16_t);
+}
+
+int TerrainLod::getIndexSize() const {
+    return shortIndices.empty() ? static_cast<int>(sizeof(unsigned int)) : static_cast<int>(sizeof(uint16_t));
+}
+
+unsigned int TerrainLod::getRestartIndex() const {
+    return shortIndices.empty() ? 0xFFFFFFFFu : 0xFFFFu;
+}
+
+TerrainLod::IndexMode TerrainLod::getIndexMode() const {
+    return indexMode;
+}
+
+const std::vector<TerrainLod::Draw>& TerrainLod::getDraws() const {
+    return draws;
+}
+
+unsigned long long TerrainLod::getTriangleCount() const {
+    return triangleCount;
+}
+
+int TerrainLod::getPatchCount() const {
+    return static_cast<int>(patches.size());
+}
+
+int TerrainLod::getVisiblePatchCount() const {
+    return visiblePatchCount;
+}
@@ -0,0 +1,91 @@
+#ifndef TERRAIN_LOD_HPP
+#define TERRAIN_LOD_HPP
+
+#include <cstdint>
+#include <vector>
+#include "math.hpp"
+
+// Geomipmapping for the terrain grid. The grid is split into square patches. Every frame each
+// patch picks a level from its distance to the camera: level L keeps every 2^L-th vertex. The
+// edges facing a coarser neighbour snap their odd vertices onto the neighbour's grid, so no cracks open.
+// Index lists are prebuilt per (patch shape, level, edge mask) relative to the patch origin and are
+// drawn with a base vertex, so the vertex buffer is shared by every level.
+// The patches are also kept in a quadtree of bounding boxes, and only those in the view frustum are drawn.
+// Indices are relative to the patch origin, so they are packed into 16 bits whenever the grid is
+// narrow enough (up to 2046 columns, which covers every --lod setting).
+class TerrainLod {
+public:
+    static const int patchCells = 32; // Grid cells along one side of a full patch
+    static const int maxLevel = 5;    // Coarsest level keeps only the patch corners
+
+    // Triangles: 3 indices per triangle (GL_TRIANGLES). Strips: one triangle strip per patch row,
+    // rows separated by getRestartIndex (GL_TRIANGLE_STRIP with primitive restart), about a third of the indices.
+    enum class IndexMode { Triangles, Strips };
+
+    // One draw call: indexCount indices starting at indexOffset, added to baseVertex
+    struct Draw {
+        unsigned int indexOffset, indexCount, baseVertex;
+    };
+
+    TerrainLod();
+
+    // Split a columns x rows grid (9-float vertices, as in TerrainMesh) into patches and build the index lists
+    void build(int columns, int rows, const std::vector<float>& verticesWithNormals, IndexMode mode = IndexMode::Triangles);
+    // Pick the level of every patch and the patches to draw. lodDistance is in patch widths: patches closer
+    // than that get full detail, and each doubling of the distance drops one level. 0 keeps full detail everywhere.
+    void selectLevels(const Vec& cameraPos, float lodDistance, const Frustum& frustum);
+
+    // All prebuilt index lists, uploaded once: getIndexBytes bytes of getIndexSize-byte (2 or 4) indices
+    const void* getIndexData() const;
+    size_t getIndexBytes() const;
+    int getIndexSize() const;
+    unsigned int getRestartIndex() const; // All bits set at the index size; only used with IndexMode::Strips
+    IndexMode getIndexMode() const;
+    const std::vector<Draw>& getDraws() const;           // Draws for the last selectLevels call
+    unsigned long long getTriangleCount() const;         // Triangles drawn by getDraws
+    int getPatchCount() const;
+    int getVisiblePatchCount() const;                    // Patches left after frustum culling
+
+private:
+    struct Patch {
+        int x0, z0;          // First grid column/row of the patch
+        int shape;           // Bit 0: narrower than patchCells along x, bit 1: along z
+        Vec boundsMin, boundsMax;
+        int level;
+        bool visible;
+    };
+
+    // Quadtree node over the rectangle [px0, px1) x [pz0, pz1) of the patch grid
+    struct QuadNode {
+        int px0, pz0, px1, pz1;
+        Vec boundsMin, boundsMax;
+        int children[4]; // -1 where there is no child; a node without children holds one patch
+    };
+
+    struct Range {
+        unsigned int offset, count, triangles;
+    };
+
+    unsigned int appendPatchIndices(int cellsX, int cellsZ, int stride, int edgeMask); // Return the triangles added
+    unsigned int appendPatchStrips(int cellsX, int cellsZ, int stride, int edgeMask);
+    void packIndices();
+    Range& rangeFor(int shape, int level, int edgeMask);
+    int buildNode(int px0, int pz0, int px1, int pz1);
+    void cullNode(int node, const Frustum& frustum);
+    void markVisible(const QuadNode& node);
+
+    int columns, rows, patchesX, patchesZ;
+    int shapeCells[2][2]; // [axis][partial] cells along x (axis 0) or z (axis 1)
+    float patchWorldSize;
+    std::vector<Patch> patches;
+    std::vector<QuadNode> nodes; // Root first
+    IndexMode indexMode;
+    std::vector<unsigned int> indices;   // Emptied by packIndices when the 16-bit copy is used
+    std::vector<uint16_t> shortIndices;
+    std::vector<Range> ranges;
+    std::vector<Draw> draws;
+    unsigned long long triangleCount;
+    int visiblePatchCount;
+};
+
+#endif // TERRAIN_LOD_HPP
@@ -0,0 +1,632 @@
+#include "TerrainMesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include "MappedFile.hpp"
+#include "PerlinNoise.hpp"
+#include "Profiler.hpp"
+#include "TerrainCache.hpp"
+#include "math.hpp"
+
+TerrainMesh::TerrainMesh()
+    : compactHeightMin(0.0f), compactHeightMax(0.0f), seed(0),
+    minheight(std::numeric_limits<float>::max()), maxheight(std::numeric_limits<float>::min()), 
+    perlinNoise(0), threadPool(nullptr), vertexOutput(nullptr), noiseLayers(nullptr), floatNoise(false){
+    }
+
+// Use the given pool for the row-parallel stages; nullptr keeps everything on the calling thread
+void TerrainMesh::setThreadPool(ThreadPool* pool) {
+    threadPool = pool;
+}
+
+void TerrainMesh::setVertexOutput(float* output) {
+    vertexOutput = output;
+}
+
+void TerrainMesh::setNoiseLayers(NoiseLayerCache* layers) {
+    noiseLayers = layers;
+}
+
+void TerrainMesh::setErosion(const ErosionSettings& settings) {
+    erosion = settings;
+}
+
+void TerrainMesh::setFloatNoise(bool enabled) {
+    floatNoise = enabled;
+}
+
+// Run task over row bands [rowBegin, rowEnd) of a grid with the given number of rows
+void TerrainMesh::forEachRowBand(int rows, const std::function<void(int, int)>& task) const {
+    if (threadPool) {
+        threadPool->parallelFor(0, rows, task);
+    } else {
+        task(0, rows);
+    }
+}
+
+// Initialize the terrain
+void TerrainMesh::init(const int& width_, const int& step_, const int& seed_){
+    width = width_;
+    height = width_;
+    step = step_;
+    seed = seed_;
+    perlinNoise.initialize(seed_);
+}
+
+void TerrainMesh::setLevels() {
+    waterLevel = ((maxheight - minheight) * 0.35f + minheight); // Set the water level
+    heightDif_low = (minheight + ((maxheight - minheight)* 0.4f)) * width / 60.0f ; // Set the height difference lower limit
+    heightDif_high = heightDif_low * 0.1 ; // Set the height difference upper limit
+    waterdepthMax = (waterLevel - minheight) * width / 60.0f;
+}
+
+// Generate the terrain heights and vertices. The raw noise goes into height_map, which is then
+// scaled in place while the final 9-float vertices are written straight into verticesWithNormals
+// (normal slots are filled by generateTerrainNormals), so no intermediate copies of the grid are made.
+void TerrainMesh::generateBaseTerrain(double frequency, int octave, double amplitude, double persistence, double lacunarity) {
+    ScopedTimer timer("base_terrain");
+    const int columns = width / step;
+    const int rows = height / step;
+
+    const size_t count = static_cast<size_t>(rows) * columns;
+    height_map.resize(count);
+    verticesWithNormals.resize(count * 9);
+
+    if (noiseLayers) {
+        sumNoiseLayers(frequency, octave, amplitude, persistence, lacunarity);
+        setLevels();
+        scaleBaseTerrain();
+        timer.addCounter("vertices", static_cast<long long>(count));
+        return;
+    }
+
+    // Generate the terrain height values, one band of rows per task.
+    // Each band reduces its own min/max so the shared values are only touched once per band.
+    std::mutex heightRangeMutex;
+    forEachRowBand(rows, [&](int rowBegin, int rowEnd) {
+        float bandMin = std::numeric_limits<float>::max();
+        float bandMax = std::numeric_limits<float>::min();
+        // A whole row goes through the batch (SIMD) noise kernel at once
+        std::vector<double> nx(columns), nz(columns), rowNoise(floatNoise ? 0 : columns);
+        std::vector<float> rowNoiseFloat(floatNoise ? columns : 0);
+        for (int column = 0; column < columns; ++column) {
+            int x = -width / 2 + column * step;
+            nx[column] = static_cast<float>(x) / width;
+        }
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            int z = -height / 2 + row * step;
+            std::fill(nz.begin(), nz.end(), static_cast<float>(z) / height);
+            if (floatNoise) {
+                perlinNoise.generateNoiseBatch(nx.data(), nz.data(), 0.5, columns, rowNoiseFloat.data(), frequency, amplitude, octave, persistence, lacunarity);
+            } else {
+                perlinNoise.generateNoiseBatch(nx.data(), nz.data(), 0.5, columns, rowNoise.data(), frequency, amplitude, octave, persistence, lacunarity);
+            }
+            for (int column = 0; column < columns; ++column) {
+                float sample = (floatNoise ? rowNoiseFloat[column] : rowNoise[column]) + 1.5;
+                height_map[static_cast<size_t>(row) * columns + column] = sample;
+                if (sample < bandMin) bandMin = sample;
+                if (sample > bandMax) bandMax = sample;
+            }
+        }
+        std::lock_guard<std::mutex> lock(heightRangeMutex);
+        if (bandMin < minheight) minheight = bandMin;
+        if (bandMax > maxheight) maxheight = bandMax;
+    });
+
+    setLevels();
+    scaleBaseTerrain();
+    timer.addCounter("vertices", static_cast<long long>(count));
+}
+
+// generateBaseTerrain's raw noise from noiseLayers, evaluating only the octaves it does not hold yet.
+// Every step matches PerlinNoise::generateNoiseBatch, so the sums are bit-identical to it.
+void TerrainMesh::sumNoiseLayers(double frequency, int octave, double amplitude, double persistence, double lacunarity) {
+    const int columns = width / step;
+    const int rows = height / step;
+    noiseLayers->prepare(width, step, perlinNoise.getPermutation(), frequency, lacunarity);
+
+    std::vector<double> nx(columns);
+    for (int column = 0; column < columns; ++column) {
+        int x = -width / 2 + column * step;
+        nx[column] = static_cast<float>(x) / width;
+    }
+    double octaveFrequency = frequency;
+    for (int i = 0; i < octave; ++i) {
+        if (static_cast<size_t>(i) == noiseLayers->getLayerCount()) {
+            ScopedTimer layerTimer("noise_layer");
+            double* layer = noiseLayers->addLayer().data();
+            forEachRowBand(rows, [&](int rowBegin, int rowEnd) {
+                std::vector<double> scaledX(columns), scaledZ(columns);
+                for (int column = 0; column < columns; ++column) {
+                    scaledX[column] = nx[column] * octaveFrequency;
+                }
+                for (int row = rowBegin; row < rowEnd; ++row) {
+                    int z = -height / 2 + row * step;
+                    std::fill(scaledZ.begin(), scaledZ.end(), static_cast<double>(static_cast<float>(z) / height) * octaveFrequency);
+                    perlinNoise.noiseBatch(scaledX.data(), scaledZ.data(), 0.5 * octaveFrequency, columns,
+                                           layer + static_cast<size_t>(row) * columns);
+                }
+            });
+            layerTimer.addCounter("vertices", static_cast<long long>(columns) * rows);
+        }
+        octaveFrequency *= lacunarity;
+    }
+
+    // Weighted sum, one band of rows per task, reducing min/max per band as generateBaseTerrain does
+    std::mutex heightRangeMutex;
+    forEachRowBand(rows, [&](int rowBegin, int rowEnd) {
+        float bandMin = std::numeric_limits<float>::max();
+        float bandMax = std::numeric_limits<float>::min();
+        std::vector<double> rowNoise(columns);
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            const size_t rowStart = static_cast<size_t>(row) * columns;
+            std::fill(rowNoise.begin(), rowNoise.end(), 0.0);
+            double octaveAmplitude = amplitude;
+            double maxAmplitude = 0.0;
+            for (int i = 0; i < octave; ++i) {
+                const double* layer = noiseLayers->getLayer(i).data() + rowStart;
+                for (int column = 0; column < columns; ++column) {
+                    rowNoise[column] += octaveAmplitude * layer[column];
+                }
+                maxAmplitude += octaveAmplitude;
+                octaveAmplitude *= persistence;
+            }
+            for (int column = 0; column < columns; ++column) {
+                double value = rowNoise[column] / maxAmplitude;
+                value = 2.0 * value - 1.0;
+                float sample = value * maxAmplitude + 1.5;
+                height_map[rowStart + column] = sample;
+                if (sample < bandMin) bandMin = sample;
+                if (sample > bandMax) bandMax = sample;
+            }
+        }
+        std::lock_guard<std::mutex> lock(heightRangeMutex);
+        if (bandMin < minheight) minheight = bandMin;
+        if (bandMax > maxheight) maxheight = bandMax;
+    });
+}
+
+// Shape and scale the raw noise in height_map in place and write the base vertices of every grid
+// vertex; normal slots are left for generateTerrainNormals. With erosion the whole heightfield is
+// shaped first, eroded, and only then written to the vertices.
+void TerrainMesh::scaleBaseTerrain() {
+    const int columns = width / step;
+    const int rows = height / step;
+    const bool eroded = erosion.iterations > 0;
+    // Every vertex has a fixed slot, so the rows can be written independently
+    forEachRowBand(rows, [&](int rowBegin, int rowEnd) {
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            int z = -height / 2 + row * step;
+            for (int column = 0; column < columns; ++column) {
+                int x = -width / 2 + column * step;
+                size_t i = static_cast<size_t>(row) * columns + column;
+
+                // Adjust the height of the terrain based on the terrain shape
+                float sample = perlinNoise.adjustNoiseForTerrainShape(height_map[i], x, z, width, height, step, waterLevel);
+                height_map[i] = sample * width / 60.0f; // Kept for the water pass height texture
+                if (!eroded) writeBaseVertex(row, column);
+            }
+        }
+    });
+    if (!eroded) return;
+
+    // Vertices are step * 0.1 apart in x and z
+    erodeHeightField(height_map.data(), columns, rows, step * 0.1f, erosion, seed, threadPool);
+    forEachRowBand(rows, [&](int rowBegin, int rowEnd) {
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            for (int column = 0; column < columns; ++column) {
+                writeBaseVertex(row, column);
+            }
+        }
+    });
+}
+
+// Position, texture coordinates and height of one grid vertex, from its scaled height in height_map
+void TerrainMesh::writeBaseVertex(int row, int column) {
+    const int columns = width / step;
+    int x = -width / 2 + column * step;
+    int z = -height / 2 + row * step;
+    size_t i = static_cast<size_t>(row) * columns + column;
+    float scaledheight = height_map[i];
+
+    float* vertex = &verticesWithNormals[i * 9];
+    vertex[0] = x * 0.1f; // Scale x
+    vertex[1] = scaledheight; // Scale height
+    vertex[2] = z * 0.1f; // Scale z
+
+    // Generate texture coordinates
+    vertex[6] = (static_cast<float>(x) + width / 2) / width;
+    vertex[7] = (static_cast<float>(z) + height / 2) / height;
+
+    // Add the height for the terrain, used to determine if the water should be displayed
+    vertex[8] = scaledheight;
+}
+
+// generateBaseTerrain with the raw noise (+ 1.5) of every grid vertex computed elsewhere, e.g. by GpuNoise
+void TerrainMesh::generateBaseTerrainFromNoise(std::vector<float> noise) {
+    ScopedTimer timer("base_terrain");
+    const int columns = width / step;
+    const int rows = height / step;
+    const size_t count = static_cast<size_t>(rows) * columns;
+    if (noise.size() != count) {
+        throw std::invalid_argument("generateBaseTerrainFromNoise: expected one value per grid vertex");
+    }
+    height_map = std::move(noise);
+    verticesWithNormals.resize(count * 9);
+
+    std::mutex heightRangeMutex;
+    forEachRowBand(rows, [&](int rowBegin, int rowEnd) {
+        auto [bandMin, bandMax] = std::minmax_element(height_map.begin() + static_cast<size_t>(rowBegin) * columns,
+                                                      height_map.begin() + static_cast<size_t>(rowEnd) * columns);
+        std::lock_guard<std::mutex> lock(heightRangeMutex);
+        if (*bandMin < minheight) minheight = *bandMin;
+        if (*bandMax > maxheight) maxheight = *bandMax;
+    });
+
+    setLevels();
+    scaleBaseTerrain();
+    timer.addCounter("vertices", static_cast<long long>(count));
+}
+
+// Set up the water plane. It is drawn as a single quad at the water level; the shader looks the
+// terrain height under each fragment up in the height map, so no second grid is needed.
+void TerrainMesh::generateWater(){
+    ScopedTimer timer("water");
+    waterLevel = waterLevel * width / 60.0f;
+    timer.addCounter("height_map_bytes", static_cast<long long>(height_map.size() * sizeof(float)));
+}
+
+// Generate the normals of the terrain vertices, in place in verticesWithNormals.
+// The grid is regular, so each vertex gathers the face normals of the (up to) six triangles around it
+// instead of every triangle scattering into a shared array. They are summed in the order the
+// triangle walk of computeVertexNormals adds them, so the result is the same, and rows run in bands on the pool.
+void TerrainMesh::generateTerrainNormals(){
+    ScopedTimer timer("normals");
+    const int columns = width / step;
+    const int rows = height / step;
+    const int cells = columns - 1;
+
+    // Only the normal slots are written, so the positions can be read from the same buffer on every thread
+    auto position = [&](int column, int row) {
+        const float* vertex = &verticesWithNormals[(static_cast<size_t>(row) * columns + column) * 9];
+        return Vec{vertex[0], vertex[1], vertex[2]};
+    };
+    // Face normals of one row of cells: [2 * x] for the triangle (a, b, c), [2 * x + 1] for (c, d, a)
+    auto faceRow = [&](int row, std::vector<Vec>& faces) {
+        for (int x = 0; x < cells; ++x) {
+            Vec a = position(x, row);
+            Vec b = position(x + 1, row);
+            Vec c = position(x + 1, row + 1);
+            Vec d = position(x, row + 1);
+            faces[2 * x] = computeFaceNormal(a, c, b);
+            faces[2 * x + 1] = computeFaceNormal(c, a, d);
+        }
+    };
+
+    forEachRowBand(rows, [&](int rowBegin, int rowEnd) {
+        std::vector<Vec> above(2 * cells), below(2 * cells); // Cell rows above and below the current vertex row
+        if (rowBegin > 0) faceRow(rowBegin - 1, above);
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            if (row < rows - 1) faceRow(row, below);
+            for (int x = 0; x < columns; ++x) {
+                Vec normal = {0.0f, 0.0f, 0.0f};
+                if (row > 0) {
+                    if (x > 0) {
+                        normal += above[2 * (x - 1)];
+                        normal += above[2 * (x - 1) + 1];
+                    }
+                    if (x < cells) normal += above[2 * x + 1];
+                }
+                if (row < rows - 1) {
+                    if (x > 0) normal += below[2 * (x - 1)];
+                    if (x < cells) {
+                        normal += below[2 * x];
+                        normal += below[2 * x + 1];
+                    }
+                }
+                normal = normalize(normal);
+
+                float* vertex = &verticesWithNormals[(static_cast<size_t>(row) * columns + x) * 9];
+                vertex[3] = normal.x;
+                vertex[4] = normal.y;
+                vertex[5] = normal.z;
+            }
+            if (vertexOutput) {
+                const size_t offset = static_cast<size_t>(row) * columns * 9;
+                std::copy_n(&verticesWithNormals[offset], static_cast<size_t>(columns) * 9, vertexOutput + offset);
+            }
+            std::swap(above, below);
+        }
+    });
+    if (vertexOutput) {
+        timer.addCounter("bytes_streamed", static_cast<long long>(verticesWithNormals.size() * sizeof(float)));
+    }
+    timer.addCounter("vertices", static_cast<long long>(verticesWithNormals.size() / 9));
+}
+
+// Pack the terrain grid of verticesWithNormals into CompactVertex
+void TerrainMesh::encodeCompactVertices() {
+    ScopedTimer timer("compact_vertices");
+    const int columns = width / step;
+    const int rows = height / step;
+    const size_t count = static_cast<size_t>(rows) * columns;
+
+    compactHeightMin = std::numeric_limits<float>::max();
+    compactHeightMax = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i < count; ++i) {
+        compactHeightMin = std::min(compactHeightMin, verticesWithNormals[i * 9 + 1]);
+        compactHeightMax = std::max(compactHeightMax, verticesWithNormals[i * 9 + 1]);
+    }
+    const float heightScale = compactHeightMax > compactHeightMin ? 65535.0f / (compactHeightMax - compactHeightMin) : 0.0f;
+
+    compactVertices.resize(count);
+    forEachRowBand(rows, [&](int rowBegin, int rowEnd) {
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            for (int column = 0; column < columns; ++column) {
+                size_t i = static_cast<size_t>(row) * columns + column;
+                const float* vertex = &verticesWithNormals[i * 9];
+                CompactVertex& compact = compactVertices[i];
+                compact.column = static_cast<uint16_t>(column);
+                compact.row = static_cast<uint16_t>(row);
+                compact.height = static_cast<uint16_t>(std::lround((vertex[1] - compactHeightMin) * heightScale));
+
+                // Project the normal onto the octahedron |x| + |y| + |z| = 1 and unfold the lower half around +y
+                float length = std::abs(vertex[3]) + std::abs(vertex[4]) + std::abs(vertex[5]);
+                float u = vertex[3] / length;
+                float v = vertex[5] / length;
+                if (vertex[4] < 0.0f) {
+                    float foldedU = (1.0f - std::abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+                    float foldedV = (1.0f - std::abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+                    u = foldedU;
+                    v = foldedV;
+                }
+                compact.normal[0] = static_cast<int8_t>(std::lround(u * 127.0f));
+                compact.normal[1] = static_cast<int8_t>(std::lround(v * 127.0f));
+            }
+        }
+    });
+    timer.addCounter("vertices", static_cast<long long>(count));
+}
+
+// Write the heights, normals and levels to path. Goes through a temporary file, so a reader never
+// maps a half-written cache.
+bool TerrainMesh::saveCache(const std::string& path, uint64_t key) const {
+    ScopedTimer timer("cache_save");
+    const int columns = width / step;
+    const int rows = height / step;
+    const size_t count = static_cast<size_t>(rows) * columns;
+    if (verticesWithNormals.size() != count * 9) return false;
+
+    TerrainCacheHeader header = {};
+    std::memcpy(header.magic, "TRNCACHE", sizeof(header.magic));
+    header.version = terrainCacheVersion;
+    header.columns = static_cast<uint32_t>(columns);
+    header.rows = static_cast<uint32_t>(rows);
+    header.key = key;
+    header.minHeight = minheight;
+    header.maxHeight = maxheight;
+    header.waterLevel = waterLevel;
+    header.heightDif_low = heightDif_low;
+    header.heightDif_high = heightDif_high;
+    header.waterdepthMax = waterdepthMax;
+
+    std::error_code error;
+    const std::filesystem::path target(path);
+    if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), error);
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(height_map.data()), static_cast<std::streamsize>(count * sizeof(float)));
+        std::vector<float> normals(static_cast<size_t>(columns) * 3); // One row at a time
+        for (int row = 0; row < rows; ++row) {
+            for (int column = 0; column < columns; ++column) {
+                std::copy_n(&verticesWithNormals[(static_cast<size_t>(row) * columns + column) * 9 + 3], 3, &normals[column * 3]);
+            }
+            file.write(reinterpret_cast<const char*>(normals.data()), static_cast<std::streamsize>(normals.size() * sizeof(float)));
+        }
+        if (!file) {
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    timer.addCounter("bytes", static_cast<long long>(sizeof(header) + count * 4 * sizeof(float)));
+    return true;
+}
+
+// Rebuild the vertices from a mapped cache file: positions and texture coordinates follow from the
+// grid, heights and normals are read straight from the mapping, one row band per task
+bool TerrainMesh::loadCache(const std::string& path, uint64_t key) {
+    ScopedTimer timer("cache_load");
+    const int columns = width / step;
+    const int rows = height / step;
+    const size_t count = static_cast<size_t>(rows) * columns;
+
+    MappedFile file(path);
+    if (!file.isOpen() || file.size() != sizeof(TerrainCacheHeader) + count * 4 * sizeof(float)) return false;
+    TerrainCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, "TRNCACHE", sizeof(header.magic)) != 0 || header.version != terrainCacheVersion ||
+        header.key != key || header.columns != static_cast<uint32_t>(columns) || header.rows != static_cast<uint32_t>(rows)) {
+        return false;
+    }
+    const float* heights = reinterpret_cast<const float*>(file.data() + sizeof(header));
+    const float* normals = heights + count;
+
+    minheight = header.minHeight;
+    maxheight = header.maxHeight;
+    waterLevel = header.waterLevel;
+    heightDif_low = header.heightDif_low;
+    heightDif_high = header.heightDif_high;
+    waterdepthMax = header.waterdepthMax;
+    height_map.assign(heights, heights + count);
+    verticesWithNormals.resize(count * 9);
+
+    forEachRowBand(rows, [&](int rowBegin, int rowEnd) {
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            int z = -height / 2 + row * step;
+            for (int column = 0; column < columns; ++column) {
+                int x = -width / 2 + column * step;
+                size_t i = static_cast<size_t>(row) * columns + column;
+                float* vertex = &verticesWithNormals[i * 9];
+                vertex[0] = x * 0.1f;
+                vertex[1] = heights[i];
+                vertex[2] = z * 0.1f;
+                vertex[3] = normals[i * 3];
+                vertex[4] = normals[i * 3 + 1];
+                vertex[5] = normals[i * 3 + 2];
+                vertex[6] = (static_cast<float>(x) + width / 2) / width;
+                vertex[7] = (static_cast<float>(z) + height / 2) / height;
+                vertex[8] = heights[i];
+            }
+            if (vertexOutput) {
+                const size_t offset = static_cast<size_t>(row) * columns * 9;
+                std::copy_n(&verticesWithNormals[offset], static_cast<size_t>(columns) * 9, vertexOutput + offset);
+            }
+        }
+    });
+    timer.addCounter("bytes", static_cast<long long>(file.size()));
+    timer.addCounter("vertices", static_cast<long long>(count));
+    return true;
+}
+
+// Convert the file into height_map and the vertex grid one row band at a time, reading each row
+// straight from the mapping. Heights are taken as they are (already scaled); maps without a stored
+// range are spread over the range the generator produces, 0..2 before scaling.
+void TerrainMesh::importHeightMap(const HeightMapFile& file) {
+    ScopedTimer timer("heightmap_import");
+    const int columns = width / step;
+    const int rows = height / step;
+    const size_t count = static_cast<size_t>(rows) * columns;
+    const float heightScale = width / 60.0f;
+    const float unrangedScale = file.hasRange() ? 1.0f : 2.0f * heightScale;
+
+    height_map.resize(count);
+    verticesWithNormals.resize(count * 9);
+    float lowest = std::numeric_limits<float>::max();
+    float highest = std::numeric_limits<float>::lowest();
+    std::mutex heightRangeMutex;
+    forEachRowBand(rows, [&](int rowBegin, int rowEnd) {
+        float bandMin = std::numeric_limits<float>::max();
+        float bandMax = std::numeric_limits<float>::lowest();
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            float* heights = &height_map[static_cast<size_t>(row) * columns];
+            file.readRow(row, heights);
+            int z = -height / 2 + row * step;
+            for (int column = 0; column < columns; ++column) {
+                int x = -width / 2 + column * step;
+                float scaledheight = heights[column] * unrangedScale;
+                heights[column] = scaledheight;
+                if (scaledheight < bandMin) bandMin = scaledheight;
+                if (scaledheight > bandMax) bandMax = scaledheight;
+
+                float* vertex = &verticesWithNormals[(static_cast<size_t>(row) * columns + column) * 9];
+                vertex[0] = x * 0.1f;
+                vertex[1] = scaledheight;
+                vertex[2] = z * 0.1f;
+                vertex[6] = (static_cast<float>(x) + width / 2) / width;
+                vertex[7] = (static_cast<float>(z) + height / 2) / height;
+                vertex[8] = scaledheight;
+            }
+        }
+        std::lock_guard<std::mutex> lock(heightRangeMutex);
+        lowest = std::min(lowest, bandMin);
+        highest = std::max(highest, bandMax);
+    });
+
+    // The levels are derived from the unscaled range, as for generated terrain
+    minheight = lowest / heightScale;
+    maxheight = highest / heightScale;
+    setLevels();
+    timer.addCounter("vertices", static_cast<long long>(count));
+}
+
+bool TerrainMesh::exportHeightMap(const std::string& path) const {
+    ScopedTimer timer("heightmap_export");
+    const int columns = width / step;
+    const int rows = height / step;
+    if (height_map.size() != static_cast<size_t>(rows) * columns) return false;
+    return writeHeightMap(path, height_map.data(), columns, rows);
+}
+
+// Free the CPU copies once they have been uploaded to the GPU
+void TerrainMesh::releaseBuffers() {
+    std::vector<float>().swap(verticesWithNormals);
+    std::vector<CompactVertex>().swap(compactVertices);
+    std::vector<float>().swap(height_map);
+}
+
+const std::vector<float>& TerrainMesh::getVerticesWithNormals() const {
+    return verticesWithNormals;
+}
+
+// Triangles of the full-detail grid (two per cell)
+long long TerrainMesh::getTriangleCount() const {
+    return 2LL * (width / step - 1) * (height / step - 1);
+}
+
+const std::vector<float>& TerrainMesh::getHeightMap() const {
+    return height_map;
+}
+
+const std::vector<CompactVertex>& TerrainMesh::getCompactVertices() const {
+    return compactVertices;
+}
+
+const float& TerrainMesh::getCompactHeightMin() const {
+    return compactHeightMin;
+}
+
+const float& TerrainMesh::getCompactHeightMax() const {
+    return compactHeightMax;
+}
+
+const float& TerrainMesh::getMinHeight() const {
+    return minheight;
+}
+
+const float& TerrainMesh::getMaxHeight() const {
+    return maxheight;
+}
+
+const float& TerrainMesh::getWaterLevel() const {
+    return waterLevel;
+}
+
+const float& TerrainMesh::getWaterdepthMax() const {
+    return waterdepthMax;
+}
+
+const float& TerrainMesh::getHeightDif_low() const {
+    return heightDif_low;
+}
+
+const float& TerrainMesh::getHeightDif_high() const {
+    return heightDif_high;
+}
+
+const int& TerrainMesh::getWidth() const {
+    return width;
+}
+
+const int& TerrainMesh::getHeight() const {
+    return height;
+}
+
+const int& TerrainMesh::getStep() const {
+    return step;
+}
+
+const PerlinNoise& TerrainMesh::getNoise() const {
+    return perlinNoise;
+}
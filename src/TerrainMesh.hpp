@@ -0,0 +1,100 @@
+#ifndef TERRAIN_MESH_HPP
+#define TERRAIN_MESH_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Erosion.hpp"
+#include "HeightMapIO.hpp"
+#include "NoiseLayers.hpp"
+#include "PerlinNoise.hpp"
+#include "ThreadPool.hpp"
+
+// Compact terrain vertex (8 bytes instead of 36): x/z and texture coordinates follow from the grid
+// position, the height is quantized between getCompactHeightMin and getCompactHeightMax, and the
+// normal is octahedral-encoded around +y.
+struct CompactVertex {
+    uint16_t column, row;
+    uint16_t height;
+    int8_t normal[2];
+};
+
+// CPU side of the terrain: heightfield, water plane and normals.
+// Has no OpenGL dependency, so it can be used headless (batch generation, benchmarks).
+class TerrainMesh {
+public:
+    TerrainMesh();
+
+    void init(const int& width, const int& step, const int& seed);
+    void setThreadPool(ThreadPool* pool);
+    // Also write every finished vertex (9 floats, as in getVerticesWithNormals) to output during
+    // generateTerrainNormals, one row band at a time, e.g. into a mapped GPU buffer. nullptr turns it off.
+    void setVertexOutput(float* output);
+    // Keep the per-octave noise of generateBaseTerrain in layers (not owned, nullptr turns it off), so
+    // a later call with more octaves only evaluates the new ones and other amplitude, persistence or
+    // fewer octaves need no noise evaluation at all. The heights are the same either way.
+    void setNoiseLayers(NoiseLayerCache* layers);
+    // Erode the shaped and scaled heights of generateBaseTerrain (and generateBaseTerrainFromNoise)
+    // before the vertices are written; settings.iterations 0, the default, leaves them as generated
+    void setErosion(const ErosionSettings& settings);
+    // Sum the noise of generateBaseTerrain with the float kernel (the float generateNoiseBatch) instead
+    // of the double one: faster, with raw noise within 2.4e-7 of the double sum at the default
+    // parameters (see README). Not used with setNoiseLayers, whose layers are double.
+    void setFloatNoise(bool enabled);
+    void generateBaseTerrain(double frequency, int octave, double amplitude, double persistence, double lacunarity);
+    void generateBaseTerrainFromNoise(std::vector<float> noise); // One raw noise value (+ 1.5) per grid vertex, row by row
+    void generateWater();
+    void generateTerrainNormals();
+    void encodeCompactVertices(); // After generateTerrainNormals
+    // Heightfield cache (TerrainCache.hpp). saveCache writes the state after generateTerrainNormals;
+    // loadCache restores it from a mapped file instead of the three generate calls, and returns false
+    // if the file is missing or was not written for this key and grid.
+    bool saveCache(const std::string& path, uint64_t key) const;
+    bool loadCache(const std::string& path, uint64_t key);
+    // Take the heights from a height map file instead of generateBaseTerrain; generateWater and
+    // generateTerrainNormals follow as usual. The file must have width / step columns and rows.
+    void importHeightMap(const HeightMapFile& file);
+    bool exportHeightMap(const std::string& path) const; // Scaled heights, after generateBaseTerrain or importHeightMap
+    void releaseBuffers();
+
+    const std::vector<float>& getVerticesWithNormals() const; // x, y, z, nx, ny, nz, u, v, height per vertex
+    long long getTriangleCount() const;
+    const std::vector<float>& getHeightMap() const; // Scaled terrain heights, one per grid vertex, row by row
+    const std::vector<CompactVertex>& getCompactVertices() const;
+    const float& getCompactHeightMin() const;
+    const float& getCompactHeightMax() const;
+    const float& getMinHeight() const;
+    const float& getMaxHeight() const;
+    const float& getWaterLevel() const;
+    const float& getWaterdepthMax() const;
+    const float& getHeightDif_low() const;
+    const float& getHeightDif_high() const;
+    const int& getWidth() const;
+    const int& getHeight() const;
+    const int& getStep() const;
+    const PerlinNoise& getNoise() const;
+
+private:
+    void forEachRowBand(int rows, const std::function<void(int, int)>& task) const;
+    void sumNoiseLayers(double frequency, int octave, double amplitude, double persistence, double lacunarity);
+    void scaleBaseTerrain();
+    void writeBaseVertex(int row, int column);
+    void setLevels(); // Water level and height difference limits from minheight and maxheight
+
+    std::vector<float> verticesWithNormals;
+    std::vector<CompactVertex> compactVertices;
+    float compactHeightMin, compactHeightMax;
+    int width, height, step, seed;
+    float minheight, maxheight;
+    PerlinNoise perlinNoise;
+    float waterLevel, heightDif_low, heightDif_high, waterdepthMax;
+    std::vector<float> height_map;
+    ThreadPool* threadPool; // Not owned
+    float* vertexOutput;    // Not owned
+    NoiseLayerCache* noiseLayers; // Not owned
+    ErosionSettings erosion;
+    bool floatNoise;
+};
+
+#endif // TERRAIN_MESH_HPP
@@ -0,0 +1,309 @@
+#include "TextureCache.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "Profiler.hpp"
+
+namespace {
+
+uint32_t loadLE32(const unsigned char* bytes) {
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+uint16_t loadLE16(const unsigned char* bytes) {
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+void storeLE16(unsigned char* bytes, uint16_t value) {
+    bytes[0] = static_cast<unsigned char>(value);
+    bytes[1] = static_cast<unsigned char>(value >> 8);
+}
+
+uint16_t toRgb565(const int color[3]) {
+    return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+}
+
+void fromRgb565(uint16_t packed, int color[3]) {
+    const int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Endpoints from the colour bounding box, inset by 1/16 of its extent so that rounding to 565 does
+// not waste the palette on outliers. Always four-colour mode, as BC1 has no alpha here.
+void encodeBc1Block(const unsigned char texels[16][3], unsigned char* block) {
+    int low[3] = {255, 255, 255}, high[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            low[c] = std::min(low[c], static_cast<int>(texels[i][c]));
+            high[c] = std::max(high[c], static_cast<int>(texels[i][c]));
+        }
+    }
+    for (int c = 0; c < 3; ++c) {
+        const int inset = (high[c] - low[c]) >> 4;
+        low[c] += inset;
+        high[c] -= inset;
+    }
+    // Every channel of high is at least that of low, so color0 >= color1
+    const uint16_t color0 = toRgb565(high), color1 = toRgb565(low);
+    storeLE16(block, color0);
+    storeLE16(block + 2, color1);
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        fromRgb565(color0, palette[0]);
+        fromRgb565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestDistance = 1 << 30;
+            for (int p = 0; p < 4; ++p) {
+                int distance = 0;
+                for (int c = 0; c < 3; ++c) {
+                    const int d = texels[i][c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance) {
+                    best = p;
+                    bestDistance = distance;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+        }
+    }
+    for (int i = 0; i < 4; ++i) block[4 + i] = static_cast<unsigned char>(indices >> (8 * i));
+}
+
+} // namespace
+
+std::string textureCachePath(const std::string& directory, const std::string& sourcePath, TextureFormat format) {
+    const std::string suffix = format == TextureFormat::Bc1 ? ".bc1.tex" : ".rgb8.tex";
+    return (std::filesystem::path(directory) / (std::filesystem::path(sourcePath).stem().string() + suffix)).string();
+}
+
+bool readBmp(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgb, std::string& error) {
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        error = "could not open " + path;
+        return false;
+    }
+    const unsigned char* bytes = file.data();
+    if (file.size() < 54 || bytes[0] != 'B' || bytes[1] != 'M') {
+        error = path + " is not a BMP file";
+        return false;
+    }
+    const uint32_t dataOffset = loadLE32(bytes + 10);
+    const int32_t fileWidth = static_cast<int32_t>(loadLE32(bytes + 18));
+    const int32_t fileHeight = static_cast<int32_t>(loadLE32(bytes + 22));
+    const uint16_t bitsPerPixel = loadLE16(bytes + 28);
+    const uint32_t compression = loadLE32(bytes + 30);
+    if (bitsPerPixel != 24 || compression != 0 || fileWidth <= 0 || fileHeight == 0) {
+        error = path + " is not an uncompressed 24-bit BMP";
+        return false;
+    }
+    width = fileWidth;
+    height = fileHeight < 0 ? -fileHeight : fileHeight;
+    const size_t stride = (static_cast<size_t>(width) * 3 + 3) & ~static_cast<size_t>(3); // Rows are padded to 4 bytes
+    if (dataOffset > file.size() || file.size() - dataOffset < stride * height) {
+        error = path + " is truncated";
+        return false;
+    }
+
+    // BGR to RGB, bottom row first; top-down files (negative height) are flipped
+    rgb.resize(static_cast<size_t>(width) * height * 3);
+    for (int row = 0; row < height; ++row) {
+        const int fileRow = fileHeight < 0 ? height - 1 - row : row;
+        const unsigned char* source = bytes + dataOffset + stride * fileRow;
+        unsigned char* destination = &rgb[static_cast<size_t>(row) * width * 3];
+        for (int x = 0; x < width; ++x) {
+            destination[x * 3] = source[x * 3 + 2];
+            destination[x * 3 + 1] = source[x * 3 + 1];
+            destination[x * 3 + 2] = source[x * 3];
+        }
+    }
+    return true;
+}
+
+void downsampleRgb(const unsigned char* source, int width, int height, unsigned char* destination) {
+    const int halfWidth = std::max(1, width / 2), halfHeight = std::max(1, height / 2);
+    for (int y = 0; y < halfHeight; ++y) {
+        const unsigned char* row0 = source + static_cast<size_t>(2 * y) * width * 3;
+        const unsigned char* row1 = source + static_cast<size_t>(std::min(2 * y + 1, height - 1)) * width * 3;
+        for (int x = 0; x < halfWidth; ++x) {
+            const int x0 = 2 * x * 3, x1 = std::min(2 * x + 1, width - 1) * 3;
+            for (int c = 0; c < 3; ++c) {
+                destination[(static_cast<size_t>(y) * halfWidth + x) * 3 + c] =
+                    static_cast<unsigned char>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+}
+
+void encodeBc1(const unsigned char* rgb, int width, int height, unsigned char* blocks) {
+    unsigned char texels[16][3];
+    for (int blockY = 0; blockY < height; blockY += 4) {
+        for (int blockX = 0; blockX < width; blockX += 4) {
+            for (int i = 0; i < 16; ++i) {
+                const int x = std::min(blockX + i % 4, width - 1), y = std::min(blockY + i / 4, height - 1);
+                std::memcpy(texels[i], rgb + (static_cast<size_t>(y) * width + x) * 3, 3);
+            }
+            encodeBc1Block(texels, blocks);
+            blocks += 8;
+        }
+    }
+}
+
+size_t textureLevelSize(TextureFormat format, int width, int height) {
+    if (format == TextureFormat::Bc1) return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8;
+    return static_cast<size_t>(width) * height * 3;
+}
+
+MipTexture::MipTexture()
+    : format(TextureFormat::Rgb8), bytes(nullptr), byteCount(0), converted(false) {
+}
+
+bool MipTexture::open(const std::string& sourcePath, const std::string& cacheDirectory, TextureFormat format_) {
+    ScopedTimer timer("texture_load");
+    format = format_;
+    std::error_code sizeError, timeError;
+    const uint64_t sourceSize = std::filesystem::file_size(sourcePath, sizeError);
+    const auto sourceTime = std::filesystem::last_write_time(sourcePath, timeError);
+    if (sizeError || timeError) {
+        error = "could not open " + sourcePath;
+        return false;
+    }
+    const int64_t sourceStamp = static_cast<int64_t>(sourceTime.time_since_epoch().count());
+    const std::string cachePath = textureCachePath(cacheDirectory, sourcePath, format);
+    if (mapCache(cachePath, sourceSize, sourceStamp)) {
+        timer.addCounter("bytes_mapped", static_cast<long long>(byteCount));
+        return true;
+    }
+    if (!convert(sourcePath, cachePath, sourceSize, sourceStamp)) return false;
+    timer.addCounter("bytes_converted", static_cast<long long>(byteCount));
+    return true;
+}
+
+bool MipTexture::mapCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime) {
+    MappedFile mapped(cachePath);
+    if (!mapped.isOpen() || mapped.size() < sizeof(TextureCacheHeader)) return false;
+    TextureCacheHeader header;
+    std::memcpy(&header, mapped.data(), sizeof(header));
+    if (std::memcmp(header.magic, "TRNTEXC", 8) != 0 || header.version != textureCacheVersion ||
+        header.format != static_cast<uint32_t>(format) || header.sourceSize != sourceSize || header.sourceTime != sourceTime ||
+        header.levelCount == 0 || header.levelCount > 32 ||
+        mapped.size() < sizeof(header) + header.levelCount * sizeof(TextureLevel)) {
+        return false;
+    }
+    std::vector<TextureLevel> table(header.levelCount);
+    std::memcpy(table.data(), mapped.data() + sizeof(header), table.size() * sizeof(TextureLevel));
+    for (const TextureLevel& level : table) {
+        if (level.width == 0 || level.height == 0 || level.size != textureLevelSize(format, level.width, level.height) ||
+            level.offset > mapped.size() || mapped.size() - level.offset < level.size) {
+            return false;
+        }
+    }
+    levels = std::move(table);
+    file = std::move(mapped);
+    bytes = file.data();
+    byteCount = file.size();
+    converted = false;
+    return true;
+}
+
+bool MipTexture::convert(const std::string& sourcePath, const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime) {
+    int width = 0, height = 0;
+    std::vector<unsigned char> level;
+    if (!readBmp(sourcePath, width, height, level, error)) return false;
+
+    // Lay out the table first, so every level can be written straight into the file image
+    levels.clear();
+    for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        levels.push_back({static_cast<uint32_t>(w), static_cast<uint32_t>(h), 0, textureLevelSize(format, w, h)});
+        if (w == 1 && h == 1) break;
+    }
+    uint64_t offset = sizeof(TextureCacheHeader) + levels.size() * sizeof(TextureLevel);
+    for (TextureLevel& entry : levels) {
+        entry.offset = offset;
+        offset += entry.size;
+    }
+    built.assign(offset, 0);
+
+    TextureCacheHeader header = {};
+    std::memcpy(header.magic, "TRNTEXC", 8);
+    header.version = textureCacheVersion;
+    header.format = static_cast<uint32_t>(format);
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+    std::memcpy(built.data(), &header, sizeof(header));
+    std::memcpy(built.data() + sizeof(header), levels.data(), levels.size() * sizeof(TextureLevel));
+
+    std::vector<unsigned char> next;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const int w = static_cast<int>(levels[i].width), h = static_cast<int>(levels[i].height);
+        unsigned char* destination = built.data() + levels[i].offset;
+        if (format == TextureFormat::Bc1) {
+            encodeBc1(level.data(), w, h, destination);
+        } else {
+            std::memcpy(destination, level.data(), level.size());
+        }
+        if (i + 1 < levels.size()) {
+            next.resize(static_cast<size_t>(levels[i + 1].width) * levels[i + 1].height * 3);
+            downsampleRgb(level.data(), w, h, next.data());
+            level.swap(next);
+        }
+    }
+    bytes = built.data();
+    byteCount = built.size();
+    converted = true;
+
+    // A cache that cannot be written only costs the next run another conversion
+    std::error_code fileError;
+    const std::filesystem::path target(cachePath);
+    if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), fileError);
+    const std::string temporary = cachePath + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(built.data()), static_cast<std::streamsize>(built.size()));
+        if (!out) {
+            std::filesystem::remove(temporary, fileError);
+            return true;
+        }
+    }
+    std::filesystem::rename(temporary, target, fileError);
+    if (fileError) std::filesystem::remove(temporary, fileError);
+    return true;
+}
+
+const std::string& MipTexture::getError() const {
+    return error;
+}
+
+bool MipTexture::wasConverted() const {
+    return converted;
+}
+
+TextureFormat MipTexture::getFormat() const {
+    return format;
+}
+
+int MipTexture::getLevelCount() const {
+    return static_cast<int>(levels.size());
+}
+
+const TextureLevel& MipTexture::getLevel(int level) const {
+    return levels[level];
+}
+
+const unsigned char* MipTexture::getLevelData(int level) const {
+    return bytes + levels[level].offset;
+}
+
+size_t MipTexture::getByteCount() const {
+    return byteCount;
+}
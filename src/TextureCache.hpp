@@ -0,0 +1,77 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.hpp"
+
+// Pixel format of every level of a texture cache file
+enum class TextureFormat : uint32_t {
+    Rgb8 = 0, // 3 bytes per texel
+    Bc1 = 1   // S3TC DXT1: 8 bytes per 4x4 block, no alpha
+};
+
+// Texture cache file, written by MipTexture. Native byte order, meant to be mapped: the header is
+// followed by levelCount TextureLevel entries, then the texels of each level. Rows run bottom to top
+// like the source BMP, which is the order glTexImage2D expects.
+struct TextureCacheHeader {
+    char magic[8]; // "TRNTEXC" and a zero byte
+    uint32_t version;
+    uint32_t format; // TextureFormat
+    uint32_t levelCount;
+    uint32_t reserved;
+    uint64_t sourceSize; // Size and modification time of the BMP the levels were built from
+    int64_t sourceTime;
+};
+
+struct TextureLevel {
+    uint32_t width, height;
+    uint64_t offset, size; // Bytes from the start of the file
+};
+
+const uint32_t textureCacheVersion = 1;
+
+// directory/<source file stem>.rgb8.tex or .bc1.tex
+std::string textureCachePath(const std::string& directory, const std::string& sourcePath, TextureFormat format);
+
+// Read an uncompressed 24-bit BMP into RGB texels, bottom row first. Returns false (and says why in error).
+bool readBmp(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgb, std::string& error);
+// Halve an RGB8 level with a 2x2 box filter; the last row or column of an odd size is dropped
+void downsampleRgb(const unsigned char* source, int width, int height, unsigned char* destination);
+// BC1 blocks of an RGB8 level, row of blocks by row of blocks. Partial edge blocks repeat their last texel.
+void encodeBc1(const unsigned char* rgb, int width, int height, unsigned char* blocks);
+size_t textureLevelSize(TextureFormat format, int width, int height);
+
+// Every mip level of a texture, down to 1x1. open maps the cache file of a BMP, or, when the cache is
+// missing, of another format or older than the BMP, builds the levels from the BMP and writes the
+// file for the next run. Needs no GL context, so it can run on a worker thread.
+class MipTexture {
+public:
+    MipTexture();
+
+    bool open(const std::string& sourcePath, const std::string& cacheDirectory, TextureFormat format);
+    const std::string& getError() const;
+    bool wasConverted() const; // open built the levels instead of mapping them
+
+    TextureFormat getFormat() const;
+    int getLevelCount() const;
+    const TextureLevel& getLevel(int level) const;
+    const unsigned char* getLevelData(int level) const;
+    size_t getByteCount() const; // Size of the whole cache file
+
+private:
+    bool mapCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime);
+    bool convert(const std::string& sourcePath, const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime);
+
+    TextureFormat format;
+    MappedFile file;
+    std::vector<unsigned char> built; // The file image when it was converted in this run
+    const unsigned char* bytes;       // Start of the file image, mapped or built
+    size_t byteCount;
+    std::vector<TextureLevel> levels;
+    bool converted;
+    std::string error;
+};
+
+#endif // TEXTURE_CACHE_HPP
@@ -0,0 +1,91 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+    return static_cast<unsigned int>(workers.size());
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+// Pop and run one queued task, releasing the lock while it runs
+bool ThreadPool::runPendingTask(std::unique_lock<std::mutex>& lock) {
+    if (tasks.empty()) return false;
+    std::function<void()> task = std::move(tasks.front());
+    tasks.pop_front();
+    lock.unlock();
+    task();
+    lock.lock();
+    return true;
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (stopping && tasks.empty()) return;
+        runPendingTask(lock);
+    }
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int, int)>& task) {
+    if (end <= begin) return;
+
+    // A few bands per thread keeps the load balanced when rows differ in cost
+    const int count = end - begin;
+    const int bandCount = std::min(count, static_cast<int>(getThreadCount()) * 4);
+    if (bandCount <= 1) {
+        task(begin, end);
+        return;
+    }
+
+    int remaining = bandCount;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int band = 0; band < bandCount; ++band) {
+            int bandBegin = begin + static_cast<int>(static_cast<long long>(count) * band / bandCount);
+            int bandEnd = begin + static_cast<int>(static_cast<long long>(count) * (band + 1) / bandCount);
+            tasks.emplace_back([this, &task, &remaining, bandBegin, bandEnd] {
+                task(bandBegin, bandEnd);
+                std::lock_guard<std::mutex> doneLock(mutex);
+                if (--remaining == 0) taskFinished.notify_all();
+            });
+        }
+    }
+    taskAvailable.notify_all();
+
+    // Help with the queue instead of idling, then wait for bands still running on workers
+    std::unique_lock<std::mutex> lock(mutex);
+    while (remaining > 0) {
+        if (!runPendingTask(lock)) {
+            taskFinished.wait(lock, [&remaining, this] { return remaining == 0 || !tasks.empty(); });
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads used by the terrain generation stages
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount = 0); // 0 means one thread per hardware core
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Split [begin, end) into contiguous bands and run task(bandBegin, bandEnd) for each of them.
+    // Blocks until every band is done; the calling thread helps, so nested calls do not deadlock.
+    void parallelFor(int begin, int end, const std::function<void(int, int)>& task);
+
+    // Queue a task to run on a worker without waiting for it
+    void submit(std::function<void()> task);
+
+    unsigned int getThreadCount() const;
+
+private:
+    void workerLoop();
+    bool runPendingTask(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable taskFinished;
+    bool stopping;
+};
+
+#endif // THREAD_POOL_HPP
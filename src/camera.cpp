@@ -1,5 +1,6 @@
 #include "camera.hpp"
 #include <GL/glut.h>
+#include <algorithm>
 #include <iostream>
 
 Camera::Camera(Vec pos)
@@ -111,6 +112,18 @@ void Camera::mouseMotion(int x, int y)
     }
 }
 
+void Camera::setPose(const Vec& position, float yaw_, float pitch_)
+{
+    cameraPos = position;
+    yaw = yaw_;
+    pitch = std::max(-89.0f, std::min(89.0f, pitch_));
+    Vec front;
+    front.x = std::cos(radians(yaw)) * std::cos(radians(pitch));
+    front.y = std::sin(radians(pitch));
+    front.z = std::sin(radians(yaw)) * std::cos(radians(pitch));
+    cameraFront = normalize(front);
+}
+
 Vec Camera::getCameraPos() const
 {
     return cameraPos;
@@ -131,4 +144,12 @@ const bool &Camera::getShowWireframe() const
     return showWireframe;
 }
 
+const float &Camera::getYaw() const
+{
+    return yaw;
+}
 
+const float &Camera::getPitch() const
+{
+    return pitch;
+}
@@ -13,11 +13,15 @@ public:
     void keyboard(unsigned char key, int x, int y);
     void mouse(int button, int state, int x, int y);
     void mouseMotion(int x, int y);
+    // Place the camera directly, e.g. from a recorded path; pitch is clamped like mouseMotion does
+    void setPose(const Vec& position, float yaw, float pitch);
 
     Vec getCameraPos() const;
     Vec getCameraFront() const;
     Vec getCameraUp() const;
     const bool& getShowWireframe() const;
+    const float& getYaw() const;
+    const float& getPitch() const;
 
 private:
     Vec cameraPos;
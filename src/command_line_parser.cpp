@@ -8,7 +8,21 @@ CommandLineParser::CommandLineParser()
       octave(10),
       amplitude(0.8),
       persistence(0.5),
-      lacunarity(2.0) {
+      lacunarity(2.0),
+      lodDistance(4.0),
+      gpuNoiseCheckBound(0.0),
+      threads(0),
+      viewRadius(4),
+      benchFrames(600),
+      erosionIterations(0),
+      headless(false),
+      infinite(false),
+      compactVertices(false),
+      triangleStrips(false),
+      gpuNoise(false),
+      floatNoise(false),
+      noiseLayers(false),
+      compressTextures(false) {
     desc.add_options()
         ("help,h", "produce help message")
         ("frequency,f", po::value<double>(&frequency)->default_value(3.0), "set frequency       Range: 1~5       Step: 1") // around 3 looks good
@@ -18,7 +32,29 @@ CommandLineParser::CommandLineParser()
         ("lacunarity,l", po::value<double>(&lacunarity)->default_value(2.0), "set lacunarity      Range: 1~3       Step: 0.1") // around 2 looks good
         ("width,w", po::value<int>(&width)->default_value(6), "set width           Range: 1~13      Step: 1" ) // The larger the width, the more detailed the terrain
         ("lod,d", po::value<int>(&step)->default_value(1), "set level of detail Range: 0~5       Step:1" )// The larger the LOD, the more detailed the terrain
-        ("seed,s", po::value<int>(&seed)->default_value(42), "set seed");
+        ("lod-distance", po::value<double>(&lodDistance)->default_value(4.0), "set patch LOD distance Range: 0~64 (in patch widths, 0 = full detail everywhere)")
+        ("seed,s", po::value<int>(&seed)->default_value(42), "set seed")
+        ("threads,j", po::value<int>(&threads)->default_value(0), "set worker threads  0 = one per core")
+        ("headless", po::bool_switch(&headless), "generate the terrain without opening a window and print a summary")
+        ("infinite", po::bool_switch(&infinite), "stream an endless terrain in chunks around the camera")
+        ("compact-vertices", po::bool_switch(&compactVertices), "upload 8-byte quantized vertices instead of 36-byte float ones (fixed-size terrain only)")
+        ("triangle-strips", po::bool_switch(&triangleStrips), "index the terrain as triangle strips with primitive restart instead of triangle lists")
+        ("gpu-noise", po::bool_switch(&gpuNoise), "evaluate the terrain noise in a fragment shader instead of on the CPU (fixed-size terrain only)")
+        ("float-noise", po::bool_switch(&floatNoise), "sum the terrain noise in single instead of double precision, faster with raw noise within 1.5e-6 (fixed-size terrain, CPU noise)")
+        ("check-gpu-noise", po::value<double>(&gpuNoiseCheckBound)->implicit_value(1e-6), "generate the noise offscreen (EGL) on the GPU and on the CPU, print the largest difference and fail if it is over this bound (1e-6 if no value)")
+        ("compress-textures", po::bool_switch(&compressTextures), "store and upload the terrain textures as BC1 (S3TC) blocks instead of RGB8 texels")
+        ("noise-layers", po::bool_switch(&noiseLayers), "keep the noise of every octave between regenerations, so the parameter keys only evaluate new octaves (fixed-size terrain, CPU noise)")
+        ("erosion", po::value<int>(&erosionIterations)->default_value(0)->implicit_value(8), "run this many hydraulic erosion iterations over the heightfield Range: 0~256 (8 if no value, fixed-size terrain only)")
+        ("view-radius", po::value<int>(&viewRadius)->default_value(4), "set chunk view radius Range: 1~16 (with --infinite)")
+        ("profile", po::value<std::string>(&profilePath)->implicit_value("profile.json"), "write per-phase timings to a JSON report (CSV if the name ends in .csv)")
+        ("cache", po::value<std::string>(&cacheDir)->implicit_value(".terrain_cache"), "load the terrain from a heightfield cache in this directory, writing it on the first run (fixed-size terrain only)")
+        ("shader-cache", po::value<std::string>(&shaderCacheDir)->implicit_value(".shader_cache"), "load linked shader programs from binaries in this directory, writing them on the first run")
+        ("export-heightmap", po::value<std::string>(&exportHeightMap), "write the generated heights to a .r16, .r32, .pgm or .png file (fixed-size terrain only)")
+        ("import-heightmap", po::value<std::string>(&importHeightMap), "render the heights of a .r16, .r32, .pgm or .png file instead of generating them (fixed-size terrain only)")
+        ("bench-flythrough", po::value<std::string>(&benchFlythrough)->implicit_value("flythrough.json"), "render a camera path offscreen (EGL, no window needed) and write frame time percentiles and triangles per frame to this JSON file")
+        ("camera-path", po::value<std::string>(&cameraPath), "camera path file for --bench-flythrough, as written by --record-camera (default: an orbit over the terrain)")
+        ("bench-frames", po::value<int>(&benchFrames)->default_value(600), "frames of the generated --bench-flythrough path Range: 1~100000")
+        ("record-camera", po::value<std::string>(&recordCamera), "append the camera pose of every frame to this file, for --camera-path");
 }
 
 void CommandLineParser::parse(int argc, char* argv[]) {
@@ -51,6 +87,24 @@ void CommandLineParser::parse(int argc, char* argv[]) {
         if (step < 0 || step > 5) {
             throw std::out_of_range("Step must be between 0 and 5.");
         }
+        if (lodDistance < 0.0 || lodDistance > 64.0) {
+            throw std::out_of_range("LOD distance must be between 0 and 64.");
+        }
+        if (threads < 0) {
+            throw std::out_of_range("Threads must not be negative.");
+        }
+        if (viewRadius < 1 || viewRadius > 16) {
+            throw std::out_of_range("View radius must be between 1 and 16.");
+        }
+        if (benchFrames < 1 || benchFrames > 100000) {
+            throw std::out_of_range("Bench frames must be between 1 and 100000.");
+        }
+        if (erosionIterations < 0 || erosionIterations > 256) {
+            throw std::out_of_range("Erosion iterations must be between 0 and 256.");
+        }
+        if (vm.count("check-gpu-noise") && !(gpuNoiseCheckBound > 0.0)) {
+            throw std::out_of_range("The GPU noise check bound must be positive.");
+        }
     } catch (const po::error& ex) {
         std::cerr << "Error: " << ex.what() << "\n";
         throw;
@@ -92,4 +146,90 @@ int CommandLineParser::getStep() const {
     return step;
 }
 
+int CommandLineParser::getThreads() const {
+    return threads;
+}
+
+bool CommandLineParser::isHeadless() const {
+    return headless;
+}
+
+const std::string& CommandLineParser::getProfilePath() const {
+    return profilePath;
+}
+
+bool CommandLineParser::isInfinite() const {
+    return infinite;
+}
+
+int CommandLineParser::getViewRadius() const {
+    return viewRadius;
+}
+
+double CommandLineParser::getLodDistance() const {
+    return lodDistance;
+}
+
+bool CommandLineParser::useCompactVertices() const {
+    return compactVertices;
+}
+
+bool CommandLineParser::useTriangleStrips() const {
+    return triangleStrips;
+}
+
+bool CommandLineParser::useGpuNoise() const {
+    return gpuNoise;
+}
+
+bool CommandLineParser::useFloatNoise() const {
+    return floatNoise;
+}
+
+bool CommandLineParser::useNoiseLayers() const {
+    return noiseLayers;
+}
+
+bool CommandLineParser::useCompressedTextures() const {
+    return compressTextures;
+}
+
+const std::string& CommandLineParser::getCacheDir() const {
+    return cacheDir;
+}
+
+const std::string& CommandLineParser::getExportHeightMap() const {
+    return exportHeightMap;
+}
+
+const std::string& CommandLineParser::getImportHeightMap() const {
+    return importHeightMap;
+}
+
+const std::string& CommandLineParser::getBenchFlythrough() const {
+    return benchFlythrough;
+}
+
+const std::string& CommandLineParser::getCameraPath() const {
+    return cameraPath;
+}
+
+int CommandLineParser::getBenchFrames() const {
+    return benchFrames;
+}
+
+int CommandLineParser::getErosionIterations() const {
+    return erosionIterations;
+}
+
+double CommandLineParser::getGpuNoiseCheckBound() const {
+    return gpuNoiseCheckBound;
+}
 
+const std::string& CommandLineParser::getRecordCamera() const {
+    return recordCamera;
+}
+
+const std::string& CommandLineParser::getShaderCacheDir() const {
+    return shaderCacheDir;
+}
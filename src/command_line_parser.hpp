@@ -2,6 +2,7 @@
 #define COMMAND_LINE_PARSER_H
 
 #include <boost/program_options.hpp>
+#include <string>
 
 namespace po = boost::program_options;
 
@@ -19,13 +20,38 @@ public:
     int getSeed() const;
     int getWidth() const;
     int getStep() const;
+    int getThreads() const;
+    bool isHeadless() const;
+    bool isInfinite() const;
+    bool useCompactVertices() const;
+    bool useTriangleStrips() const;
+    bool useGpuNoise() const;
+    bool useFloatNoise() const;
+    bool useNoiseLayers() const;
+    bool useCompressedTextures() const;
+    int getViewRadius() const;
+    double getLodDistance() const;
+    const std::string& getProfilePath() const;
+    const std::string& getCacheDir() const;
+    const std::string& getShaderCacheDir() const;
+    const std::string& getExportHeightMap() const;
+    const std::string& getImportHeightMap() const;
+    const std::string& getBenchFlythrough() const; // Report path; empty unless --bench-flythrough was given
+    const std::string& getCameraPath() const;
+    int getBenchFrames() const;
+    int getErosionIterations() const; // 0 unless --erosion was given
+    double getGpuNoiseCheckBound() const; // 0 unless --check-gpu-noise was given
+    const std::string& getRecordCamera() const;
 
 private:
     po::options_description desc;
     po::variables_map vm;
 
-    double frequency, amplitude, persistence, lacunarity;
-    int octave, seed, width, step;
+    double frequency, amplitude, persistence, lacunarity, lodDistance, gpuNoiseCheckBound;
+    int octave, seed, width, step, threads, viewRadius, benchFrames, erosionIterations;
+    bool headless, infinite, compactVertices, triangleStrips, gpuNoise, floatNoise, noiseLayers, compressTextures;
+    std::string profilePath, cacheDir, shaderCacheDir, exportHeightMap, importHeightMap;
+    std::string benchFlythrough, cameraPath, recordCamera;
 };
 
 #endif // COMMAND_LINE_PARSER_H
@@ -1,8 +1,9 @@
 #include "lighting.hpp"
 
-Lighting::Lighting(){}
+Lighting::Lighting() : cubeVAO(0), cubeVBO(0), cubeEBO(0) {}
 
 Lighting::~Lighting() {
+    if (cubeVAO == 0) return; // The cube was never uploaded (headless run)
     glDeleteBuffers(1, &cubeVBO);
     glDeleteBuffers(1, &cubeEBO);
     glDeleteVertexArrays(1, &cubeVAO);
@@ -1,16 +1,33 @@
 #include <GL/glew.h>
 #include <GL/freeglut.h>
+#include <sys/resource.h>
 #include <iostream>
 #include <vector>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <algorithm>
 #include "shader.hpp"
-#include "PerlinNoise.cpp"
 #include "camera.hpp"
 #include "command_line_parser.hpp"
 #include "lighting.hpp"
 #include "TerrainGenerate.hpp"
+#include "TerrainChunk.hpp"
+#include "ChunkManager.hpp"
+#include "TerrainMesh.hpp"
+#include "ThreadPool.hpp"
+#include "Profiler.hpp"
+#include "TerrainCache.hpp"
+#include "HeightMapIO.hpp"
+#include "GpuNoise.hpp"
+#include "Flythrough.hpp"
+#include "OffscreenContext.hpp"
+#include "RenderState.hpp"
+#include "ProgramCache.hpp"
+#include "TextureCache.hpp"
 
 const int WIDTH = 1024; 
 
@@ -18,39 +35,301 @@ GLuint TerrainShaderProgram;
 GLuint CubeShaderProgram;
 GLuint texture1, texture2;
 
+// Uniform locations of the two programs, looked up once after linking
+struct TerrainUniforms {
+    GLint lightPos, useWaterTexture, ambientLight;
+    GLint waterLevel, heightDif_low, heightDif_high, waterDepthMax;
+    GLint texture1, texture2, heightMap;
+};
+struct CubeUniforms {
+    GLint model, lightColor;
+};
+static TerrainUniforms terrainUniforms;
+static CubeUniforms cubeUniforms;
+static FrameUniforms frameUniforms; // View and projection for both programs
+
 static auto terrain = std::make_unique<Terrain>(); 
 static auto lighting = std::make_unique<Lighting>(); 
 static Camera camera({0, 0, WIDTH});
+static std::shared_ptr<const ChunkGenerator> chunkGenerator; // Only set with --infinite
+static std::unique_ptr<ChunkManager> chunkManager;
+static std::unique_ptr<GpuNoise> gpuNoise; // Only set with --gpu-noise
 float angle = 0.0f;
 
 std::chrono::time_point<std::chrono::high_resolution_clock> lastTime;
+std::string profilePath; // Empty unless --profile was given
+float lodDistance; // Patch widths before the terrain drops a level of detail, 0 = full detail
+bool compactVertices; // Terrain uploaded as CompactVertex, drawn with the compact vertex shader
+bool useGpuNoise; // Fixed terrain noise evaluated by GpuNoise
+static bool offscreen; // Rendering into an OffscreenContext for --bench-flythrough, no GLUT window
+static std::ofstream cameraRecording; // Open with --record-camera
+static std::string shaderCacheDir; // Program binaries of --shader-cache, empty to compile every run
+static bool compressTextures; // BC1 textures with --compress-textures
+const char* const textureCacheDir = ".texture_cache"; // Mip levels of the BMP textures, converted on first use
+
+// Fixed terrain settings, kept for regenerating it when a parameter key is pressed
+static TerrainKey terrainParameters;           // What terrain, or nextTerrain once started, is generated with
+static TerrainLod::IndexMode terrainIndexMode;
+static std::string terrainCacheDir;             // Empty unless --cache applies
+static ThreadPool* terrainPool;
+static bool liveTerrainUpdates;                 // False with --infinite and for imported height maps
+static bool terrainUploaded;                    // The first fixed terrain has been uploaded
+static NoiseLayerCache noiseLayers;             // Per-octave noise shared by successive terrains, with --noise-layers
+static bool useNoiseLayers;
+static std::unique_ptr<Terrain> nextTerrain;    // Regenerated terrain, drawn in place of terrain once it is ready
+static bool regenerationQueued;                 // Parameters changed while the terrain could not be regenerated yet
+static std::chrono::time_point<std::chrono::high_resolution_clock> regenerationStart;
 
 void updateFPS();
 
-void init(double frequency, int octave, double amplitude, double persistence, double lacunarity, int width) {
-    // Initialize GLEW
-    if (glewInit() != GLEW_OK) {
-        std::cerr << "Failed to initialize GLEW" << '\n';
+// Generate the terrain on the CPU only, without creating a window or GL context
+int runHeadless(double frequency, int octave, double amplitude, double persistence, double lacunarity, int width, int step, int seed, int erosionIterations, bool floatNoise, ThreadPool& pool,
+                const std::string& cachePath, uint64_t cacheKey, const HeightMapFile* heightMapImport, const std::string& heightMapExportPath) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    TerrainMesh mesh;
+    mesh.init(width, step, seed);
+    mesh.setThreadPool(&pool);
+    ErosionSettings erosion;
+    erosion.iterations = erosionIterations;
+    mesh.setErosion(erosion);
+    mesh.setFloatNoise(floatNoise);
+    bool cached = !heightMapImport && !cachePath.empty() && mesh.loadCache(cachePath, cacheKey);
+    if (heightMapImport) {
+        mesh.importHeightMap(*heightMapImport);
+        mesh.generateWater();
+        mesh.generateTerrainNormals();
+    } else if (!cached) {
+        mesh.generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
+        mesh.generateWater();
+        mesh.generateTerrainNormals();
+        if (!cachePath.empty() && !mesh.saveCache(cachePath, cacheKey)) {
+            std::cerr << "Could not write terrain cache: " << cachePath << '\n';
+        }
+    }
+
+    if (!heightMapExportPath.empty() && mesh.exportHeightMap(heightMapExportPath)) {
+        std::cout << "Height map written to " << heightMapExportPath << '\n';
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << (heightMapImport ? "Headless import finished in " : cached ? "Headless cache load finished in " : "Headless generation finished in ") << elapsed.count() << " ms"
+              << " Vertices: " << mesh.getVerticesWithNormals().size() / 9
+              << " Triangles: " << mesh.getTriangleCount()
+              << " Min height: " << mesh.getMinHeight() << " Max height: " << mesh.getMaxHeight()
+              << " Water level: " << mesh.getWaterLevel() << '\n';
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "Peak RSS: " << usage.ru_maxrss / 1024 << " MiB" << '\n';
+
+    if (!profilePath.empty()) {
+        Profiler::instance().writeReport(profilePath);
+    }
+    return 0;
+}
+
+// Pass the water level and height difference limits of the generated terrain to the terrain shader
+void setTerrainLevels(float waterLevel, float heightDif_low, float heightDif_high, float waterdepthMax) {
+    glUseProgram(TerrainShaderProgram);
+    glUniform1f(terrainUniforms.waterLevel, waterLevel); // Set the water level
+    glUniform1f(terrainUniforms.heightDif_low, heightDif_low);
+    glUniform1f(terrainUniforms.heightDif_high, heightDif_high);
+    glUniform1f(terrainUniforms.waterDepthMax, waterdepthMax);
+}
+
+void lookUpUniforms() {
+    terrainUniforms.lightPos = glGetUniformLocation(TerrainShaderProgram, "lightPos");
+    terrainUniforms.useWaterTexture = glGetUniformLocation(TerrainShaderProgram, "useWaterTexture");
+    terrainUniforms.ambientLight = glGetUniformLocation(TerrainShaderProgram, "ambientLight");
+    terrainUniforms.waterLevel = glGetUniformLocation(TerrainShaderProgram, "waterLevel");
+    terrainUniforms.heightDif_low = glGetUniformLocation(TerrainShaderProgram, "HeightDif_low");
+    terrainUniforms.heightDif_high = glGetUniformLocation(TerrainShaderProgram, "HeightDif_high");
+    terrainUniforms.waterDepthMax = glGetUniformLocation(TerrainShaderProgram, "waterDepthMax");
+    terrainUniforms.texture1 = glGetUniformLocation(TerrainShaderProgram, "texture1");
+    terrainUniforms.texture2 = glGetUniformLocation(TerrainShaderProgram, "texture2");
+    terrainUniforms.heightMap = glGetUniformLocation(TerrainShaderProgram, "heightMap");
+    cubeUniforms.model = glGetUniformLocation(CubeShaderProgram, "model");
+    cubeUniforms.lightColor = glGetUniformLocation(CubeShaderProgram, "lightColor");
+}
+
+// Everything a fixed terrain needs before startGeneration, apart from height map import/export
+void configureTerrain(Terrain& target, const TerrainKey& parameters) {
+    target.init(parameters.width, parameters.step, parameters.seed);
+    target.setThreadPool(terrainPool);
+    target.setCompactVertices(compactVertices);
+    target.setIndexMode(terrainIndexMode);
+    if (!terrainCacheDir.empty()) {
+        target.setCache(terrainCachePath(terrainCacheDir, parameters), hashTerrainKey(parameters));
+    }
+    target.setGpuNoise(gpuNoise.get());
+    // Only one terrain generates at a time (see requestRegeneration), so they can share the layers
+    if (useNoiseLayers) target.setNoiseLayers(&noiseLayers);
+    ErosionSettings erosion;
+    erosion.iterations = parameters.erosion;
+    target.setErosion(erosion);
+    target.setFloatNoise(parameters.floatNoise);
+}
+
+// Generate the fixed terrain again with terrainParameters in the background. The current terrain is
+// drawn until the new one is ready; changes made in the meantime are picked up once it is.
+void requestRegeneration() {
+    if (!terrainUploaded || nextTerrain) {
+        regenerationQueued = true;
+        return;
+    }
+    regenerationQueued = false;
+    regenerationStart = std::chrono::high_resolution_clock::now();
+    nextTerrain = std::make_unique<Terrain>();
+    configureTerrain(*nextTerrain, terrainParameters);
+    nextTerrain->startGeneration(terrainParameters.frequency, terrainParameters.octave, terrainParameters.amplitude,
+                                 terrainParameters.persistence, terrainParameters.lacunarity);
+}
+
+// Change one generation parameter within its command line range and regenerate the fixed terrain
+void adjustTerrainParameters(unsigned char key) {
+    if (!liveTerrainUpdates) {
+        std::cerr << "The parameter keys only apply to the generated fixed-size terrain" << '\n';
         return;
     }
+    TerrainKey& parameters = terrainParameters;
+    switch (key) {
+        case '4': parameters.frequency = std::max(1.0, parameters.frequency - 0.5); break;
+        case '5': parameters.frequency = std::min(5.0, parameters.frequency + 0.5); break;
+        case '6': parameters.octave = std::max(2, parameters.octave - 1); break;
+        case '7': parameters.octave = std::min(20, parameters.octave + 1); break;
+        // Rounded to the 0.01 step, so repeated presses land on the values the command line gives
+        case '8': parameters.persistence = std::max(0.4, std::round(parameters.persistence * 100.0 - 1.0) / 100.0); break;
+        case '9': parameters.persistence = std::min(0.6, std::round(parameters.persistence * 100.0 + 1.0) / 100.0); break;
+        case '0': ++parameters.seed; break;
+    }
+    std::cout << "Regenerating terrain: Frequency: " << parameters.frequency << " Octave: " << parameters.octave
+              << " Persistence: " << parameters.persistence << " Seed: " << parameters.seed << '\n';
+    requestRegeneration();
+}
+
+// True once the fixed terrain can be drawn. Finishes its upload on the first frame after generation is
+// done, and swaps in a regenerated terrain the same way.
+bool terrainReady() {
+    if (!terrainUploaded) {
+        if (!terrain->finishGeneration(TerrainShaderProgram)) return false;
+        setTerrainLevels(terrain->getWaterLevel(), terrain->getHeightDif_low(), terrain->getHeightDif_high(), terrain->getWaterdepthMax());
+        if (!profilePath.empty()) {
+            Profiler::instance().writeReport(profilePath);
+        }
+        terrainUploaded = true;
+    } else if (nextTerrain && nextTerrain->finishGeneration(TerrainShaderProgram)) {
+        // The old terrain has no generation in flight, so dropping it here does not block
+        terrain = std::move(nextTerrain);
+        setTerrainLevels(terrain->getWaterLevel(), terrain->getHeightDif_low(), terrain->getHeightDif_high(), terrain->getWaterdepthMax());
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - regenerationStart;
+        std::cout << "Terrain regenerated in " << elapsed.count() << " ms" << '\n';
+    }
+    if (regenerationQueued) {
+        requestRegeneration();
+    }
+    return true;
+}
+
+// Map the cached mip levels of a BMP texture on a worker, converting it first if needed
+std::future<std::shared_ptr<MipTexture>> openTextureAsync(ThreadPool& pool, const std::string& path, TextureFormat format) {
+    auto done = std::make_shared<std::promise<std::shared_ptr<MipTexture>>>();
+    auto result = done->get_future();
+    pool.submit([done, path, format]() {
+        auto texture = std::make_shared<MipTexture>();
+        if (!texture->open(path, textureCacheDir, format)) {
+            std::cerr << "Could not load texture " << path << ": " << texture->getError() << '\n';
+            texture.reset();
+        }
+        done->set_value(std::move(texture));
+    });
+    return result;
+}
+
+GLuint uploadTexture(std::future<std::shared_ptr<MipTexture>>& pending) {
+    std::shared_ptr<MipTexture> texture = pending.get();
+    return texture ? loadTexture(*texture) : 0;
+}
+
+// A GLX build of GLEW reports a missing X display under EGL, after it has loaded the GL entry
+// points, so that is not an error offscreen
+bool initGlew() {
+    GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    if (offscreen && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY) glewStatus = GLEW_OK;
+#endif
+    if (glewStatus != GLEW_OK) {
+        std::cerr << "Failed to initialize GLEW" << '\n';
+        return false;
+    }
+    return true;
+}
+
+void init(double frequency, int octave, double amplitude, double persistence, double lacunarity, int width, ThreadPool& pool) {
+    // Initialize GLEW
+    if (!initGlew()) return;
+
+    // The textures are read on the workers while the shaders compile and the terrain generation starts
+    TextureFormat textureFormat = TextureFormat::Rgb8;
+    if (compressTextures && GLEW_EXT_texture_compression_s3tc) {
+        textureFormat = TextureFormat::Bc1;
+    } else if (compressTextures) {
+        std::cerr << "--compress-textures needs EXT_texture_compression_s3tc, using RGB8 textures" << '\n';
+    }
+    auto grassTexture = openTextureAsync(pool, "texture/grass.bmp", textureFormat);
+    auto sandTexture = openTextureAsync(pool, "texture/sand.bmp", textureFormat);
     
     // Load the shader program
-    TerrainShaderProgram = createShaderProgramFromFile("shader/sand_vertexShader.glsl", "shader/sand_fragmentShader.glsl");
-    CubeShaderProgram = createShaderProgramFromFile("shader/cube_vertex_shader.glsl", "shader/cube_fragment_shader.glsl");
+    ProgramCache programCache(shaderCacheDir);
+    {
+        ScopedTimer timer("shader_compile");
+        auto start = std::chrono::high_resolution_clock::now();
+        const char* terrainVertexShader = compactVertices ? "shader/sand_vertexShader_compact.glsl" : "shader/sand_vertexShader.glsl";
+        TerrainShaderProgram = programCache.createProgramFromFiles(terrainVertexShader, "shader/sand_fragmentShader.glsl");
+        CubeShaderProgram = programCache.createProgramFromFiles("shader/cube_vertex_shader.glsl", "shader/cube_fragment_shader.glsl");
+        timer.addCounter("programs_loaded", programCache.getLoadedCount());
+        timer.addCounter("programs_compiled", programCache.getCompiledCount());
+        if (!shaderCacheDir.empty()) {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+            std::cout << "Shaders ready in " << elapsed.count() << " ms (" << programCache.getLoadedCount() << " loaded from "
+                      << shaderCacheDir << ", " << programCache.getCompiledCount() << " compiled)" << '\n';
+        }
+    }
     if (TerrainShaderProgram == 0 || CubeShaderProgram == 0) {
         std::cerr << "Failed to create shader program" << '\n';
         return;
     }
+    lookUpUniforms();
+    frameUniforms.init();
+    frameUniforms.attach(TerrainShaderProgram);
+    frameUniforms.attach(CubeShaderProgram);
+
+    // An infinite world streams its chunks from display(); the fixed terrain is generated on the
+    // thread pool while the first frames are drawn, and display() finishes it once it is done
+    if (chunkGenerator) {
+        const WorldSettings& world = chunkGenerator->getSettings();
+        setTerrainLevels(world.waterLevel, world.heightDif_low, world.heightDif_high, world.waterdepthMax);
+    } else {
+        if (useGpuNoise) {
+            gpuNoise = std::make_unique<GpuNoise>();
+            if (gpuNoise->init(programCache)) {
+                // Configured again, so the GPU heights are cached under their own key
+                terrainParameters.gpuNoise = true;
+                configureTerrain(*terrain, terrainParameters);
+            } else {
+                std::cerr << "Generating the terrain noise on the CPU instead" << '\n';
+                gpuNoise.reset();
+            }
+        }
+        terrain->startGeneration(frequency, octave, amplitude, persistence, lacunarity);
+    }
 
-    // Load the textures
-    texture1 = loadTexture("texture/grass.bmp");
-    texture2 = loadTexture("texture/sand.bmp");
-
-    // Generate vertices, indices and normals for the terrain
-    terrain->generateBaseTerrain(frequency, octave, amplitude, persistence, lacunarity);
-    terrain->generateWater();
-    terrain->generateTerrainNormals();
-    terrain->initTerrain(TerrainShaderProgram);
+    // Upload the textures level by level once their workers are done
+    {
+        ScopedTimer timer("texture_upload");
+        texture1 = uploadTexture(grassTexture);
+        texture2 = uploadTexture(sandTexture);
+    }
 
     // Initialize the lighting cube
     lighting->initCube(width / 1024);
@@ -59,26 +338,19 @@ void init(double frequency, int octave, double amplitude, double persistence, do
     {
         //This part is for the terrain shader program
 
-        // Pass the 'const' ambientlight, water level and height difference limits parameters to the shader
+        // Pass the 'const' ambientlight parameter to the shader
         glUseProgram(TerrainShaderProgram);
-        GLint ambientLightLoc = glGetUniformLocation(TerrainShaderProgram, "ambientLight");
-        glUniform3f(ambientLightLoc, 0.3f, 0.3f, 0.3f); // Set the ambient light color
-        GLint waterLevelLoc = glGetUniformLocation(TerrainShaderProgram, "waterLevel");
-        glUniform1f(waterLevelLoc, terrain->getWaterLevel()); // Set the water level
-        GLint HeightDif_lowLoc = glGetUniformLocation(TerrainShaderProgram, "HeightDif_low");
-        glUniform1f(HeightDif_lowLoc, terrain->getHeightDif_low()); 
-        GLint HeightDif_highLoc = glGetUniformLocation(TerrainShaderProgram, "HeightDif_high");
-        glUniform1f(HeightDif_highLoc, terrain->getHeightDif_high());
-        GLint waterdepthMaxLoc = glGetUniformLocation(TerrainShaderProgram, "waterDepthMax");
-        glUniform1f(waterdepthMaxLoc, terrain->getWaterdepthMax()); 
+        glUniform3f(terrainUniforms.ambientLight, 0.3f, 0.3f, 0.3f); // Set the ambient light color
 
         // Pass the textures to the shader program
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, texture1);
-        glUniform1i(glGetUniformLocation(TerrainShaderProgram, "texture1"), 0);
+        glUniform1i(terrainUniforms.texture1, 0);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, texture2);
-        glUniform1i(glGetUniformLocation(TerrainShaderProgram, "texture2"), 1);
+        glUniform1i(terrainUniforms.texture2, 1);
+        glUniform1i(terrainUniforms.heightMap, heightMapTextureUnit);
+        glActiveTexture(GL_TEXTURE0);
     }
 
     {
@@ -86,8 +358,7 @@ void init(double frequency, int octave, double amplitude, double persistence, do
 
         // Pass the light color to the cube shader program
         glUseProgram(CubeShaderProgram);
-        GLint lightColorLoc = glGetUniformLocation(CubeShaderProgram, "lightColor");
-        glUniform3f(lightColorLoc, 1.0f, 1.0f, 1.0f); // Change the light color to white
+        glUniform3f(cubeUniforms.lightColor, 1.0f, 1.0f, 1.0f); // Change the light color to white
     }
 
     // Set the OpenGL state
@@ -105,42 +376,28 @@ void init(double frequency, int octave, double amplitude, double persistence, do
     lastTime = std::chrono::high_resolution_clock::now();
 }
 
-void display() {
+// Draw one frame from the current camera into the current framebuffer
+void renderFrame() {
     GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
-    // Set the projection matrix
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0f, 800.0f / 600.0f, 10.0f, 10000.0f);
-
-    // Get the projection matrix
-    GLdouble projectionMatrixD[16];
-    glGetDoublev(GL_PROJECTION_MATRIX, projectionMatrixD);
-    GLfloat projectionMatrix[16];
-    convertMatrix(projectionMatrixD, projectionMatrix);
-
-    // Set the view matrix
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    gluLookAt(camera.getCameraPos().x, camera.getCameraPos().y, camera.getCameraPos().z,  
-                camera.getCameraPos().x + camera.getCameraFront().x, camera.getCameraPos().y + camera.getCameraFront().y, camera.getCameraPos().z + camera.getCameraFront().z,  // 目标位置 (x, y, z)
-              camera.getCameraUp().x, camera.getCameraUp().y, camera.getCameraUp().z); 
-
-    // Get the view matrix
-    GLdouble viewMatrixD[16];
-    glGetDoublev(GL_MODELVIEW_MATRIX, viewMatrixD);
-    GLfloat viewMatrix[16];
-    convertMatrix(viewMatrixD, viewMatrix);
+    // View and projection are built on the CPU and reach both programs through one buffer update
+    FrameData frameData;
+    perspectiveMatrix(45.0, 800.0 / 600.0, 10.0, 10000.0, frameData.projection);
+    const Vec cameraPos = camera.getCameraPos();
+    lookAtMatrix(cameraPos, cameraPos + camera.getCameraFront(), camera.getCameraUp(), frameData.view);
+    multiplyMatrix(frameData.projection, frameData.view, frameData.viewProjection);
+    frameUniforms.update(frameData);
+
+    // Only the terrain patches (or chunks) inside this frustum are drawn
+    Frustum frustum = extractFrustum(frameData.projection, frameData.view);
 
     // Switch to the terrain shader program
     useShaderProgram(TerrainShaderProgram);
 
     // Set the diffuse light related properties
-    GLint lightPosLoc = glGetUniformLocation(TerrainShaderProgram, "lightPos");
-    glUniform3f(lightPosLoc, lighting->getmodelMatrix(12), lighting->getmodelMatrix(13), lighting->getmodelMatrix(14));
+    glUniform3f(terrainUniforms.lightPos, lighting->getmodelMatrix(12), lighting->getmodelMatrix(13), lighting->getmodelMatrix(14));
 
-    GLint useWaterTextureLoc = glGetUniformLocation(TerrainShaderProgram, "useWaterTexture");
-    glUniform1i(useWaterTextureLoc, GL_FALSE); // Forbid using water texture
+    glUniform1i(terrainUniforms.useWaterTexture, GL_FALSE); // Forbid using water texture
 
     // Change the polygon mode based on the showWireframe flag
     if (camera.getShowWireframe()) {
@@ -150,16 +407,23 @@ void display() {
     }
 
     // Draw the terrain
-    GL_CHECK(glBindVertexArray(terrain->getVAO()));
-    GL_CHECK(glDrawElements(GL_TRIANGLES, (terrain->getHeight() / terrain->getStep() - 1) * (terrain->getWidth() / terrain->getStep() - 1) * 6, GL_UNSIGNED_INT, 0));
-    GL_CHECK(glBindVertexArray(0));
+    const bool fixedTerrainReady = !chunkManager && terrainReady();
+    if (chunkManager) {
+        chunkManager->update(camera.getCameraPos(), frustum);
+        chunkManager->drawTerrain();
+    } else if (fixedTerrainReady) {
+        terrain->updateLod(camera.getCameraPos(), lodDistance, frustum);
+        terrain->drawTerrain();
+    }
 
     // Draw the water
-    glUniform1i(useWaterTextureLoc, GL_TRUE); // Enable drawing water
+    glUniform1i(terrainUniforms.useWaterTexture, GL_TRUE); // Enable drawing water
 
-    GL_CHECK(glBindVertexArray(terrain->getVAO()));
-    GL_CHECK(glDrawElements(GL_TRIANGLES, (terrain->getHeight() / terrain->getStep() - 1) * (terrain->getWidth() / terrain->getStep() - 1) * 6, GL_UNSIGNED_INT, (GLvoid*)((terrain->getHeight() / terrain->getStep() - 1) * (terrain->getWidth() / terrain->getStep() - 1) * 6 * sizeof(GLuint))));
-    GL_CHECK(glBindVertexArray(0));
+    if (chunkManager) {
+        chunkManager->drawWater();
+    } else if (fixedTerrainReady) {
+        terrain->drawWater();
+    }
 
     // Before drawing the light source, disable face culling and depth testing to ensure that the light source is always visible
     glDisable(GL_CULL_FACE);
@@ -167,12 +431,7 @@ void display() {
 
     // Use the cube shader program to draw the light source
     glUseProgram(CubeShaderProgram);
-    GLint modelLoc = glGetUniformLocation(CubeShaderProgram, "model");
-    GLint viewLocCube = glGetUniformLocation(CubeShaderProgram, "view");
-    GLint projLocCube = glGetUniformLocation(CubeShaderProgram, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, lighting->getmodelMatrix());
-    glUniformMatrix4fv(viewLocCube, 1, GL_FALSE, viewMatrix);
-    glUniformMatrix4fv(projLocCube, 1, GL_FALSE, projectionMatrix);
+    glUniformMatrix4fv(cubeUniforms.model, 1, GL_FALSE, lighting->getmodelMatrix());
 
     // Draw the light cube
     GL_CHECK(glBindVertexArray(lighting->getVAO()));
@@ -184,6 +443,14 @@ void display() {
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
 
+}
+
+void display() {
+    renderFrame();
+    if (cameraRecording.is_open()) {
+        writeCameraPose(cameraRecording, {camera.getCameraPos(), camera.getYaw(), camera.getPitch()});
+    }
+
     // update FPS
     updateFPS();
     
@@ -192,6 +459,17 @@ void display() {
 
 
 void cleanup() {
+    // The background generation may still be writing into the mapped vertex buffer
+    terrain->waitForGeneration();
+    if (nextTerrain) {
+        nextTerrain->waitForGeneration();
+    }
+
+    // Rewrite the profile so it also covers everything after startup
+    if (!profilePath.empty()) {
+        Profiler::instance().writeReport(profilePath);
+    }
+
     // Delete the shader programs
     deleteShaderProgram(TerrainShaderProgram);
     deleteShaderProgram(CubeShaderProgram);
@@ -213,6 +491,15 @@ void keyboard(unsigned char key, int x, int y) {
             if (angle < 0) angle += 2 * M_PI; // Make sure the angle is in the range [0, 2π]
             lighting->updateLightPosition(angle); // Update the light source position
             break;
+        case '4': // Lower / raise the noise frequency
+        case '5':
+        case '6': // Fewer / more octaves
+        case '7':
+        case '8': // Lower / raise the persistence
+        case '9':
+        case '0': // Next seed
+            adjustTerrainParameters(key);
+            break;
         default:
             camera.keyboard(key, x, y);
             break;
@@ -228,6 +515,126 @@ void mouseMotion(int x, int y) {
     camera.mouseMotion(x, y);
 }
 
+// Terrain triangles the last renderFrame drew
+unsigned long long drawnTriangleCount() {
+    if (chunkManager) return chunkManager->getDrawnTriangleCount();
+    return terrainUploaded ? terrain->getDrawnTriangleCount() : 0;
+}
+
+// Render every pose of path into an offscreen context and write the frame times to reportPath.
+// Generation and chunk streaming around the first pose finish before the first timed frame.
+int runFlythrough(const std::string& reportPath, const std::vector<CameraPose>& path, ThreadPool& pool, int viewRadius,
+                  double frequency, int octave, double amplitude, double persistence, double lacunarity, int width) {
+    const int frameWidth = 800, frameHeight = 600; // Same as the window
+    OffscreenContext context;
+    if (!context.create(frameWidth, frameHeight)) {
+        std::cerr << "--bench-flythrough needs an offscreen OpenGL context: " << context.getError() << '\n';
+        return 1;
+    }
+    offscreen = true;
+    {
+        ScopedTimer timer("startup");
+        init(frequency, octave, amplitude, persistence, lacunarity, width, pool);
+    }
+    if (TerrainShaderProgram == 0) return 1;
+    if (chunkGenerator) {
+        chunkManager = std::make_unique<ChunkManager>(chunkGenerator, pool, TerrainShaderProgram, viewRadius);
+    }
+
+    // A few untimed frames from the first pose, so shader compilation in the driver is not measured
+    const int warmupFrames = 10;
+    camera.setPose(path.front().position, path.front().yaw, path.front().pitch);
+    if (!chunkManager) {
+        terrain->waitForGeneration();
+    }
+    for (int frame = 0; frame < warmupFrames || (chunkManager && chunkManager->getPendingCount() > 0); ++frame) {
+        renderFrame();
+        glFinish();
+    }
+
+    FlythroughStats stats;
+    stats.frameMs.reserve(path.size());
+    stats.triangles.reserve(path.size());
+    for (const CameraPose& pose : path) {
+        camera.setPose(pose.position, pose.yaw, pose.pitch);
+        auto start = std::chrono::steady_clock::now();
+        renderFrame();
+        glFinish(); // Count the frame once it is rendered, not when it is queued
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        stats.frameMs.push_back(elapsed.count());
+        stats.triangles.push_back(drawnTriangleCount());
+    }
+
+    const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    std::ofstream report(reportPath);
+    if (!report.is_open()) {
+        std::cerr << "Could not write flythrough report: " << reportPath << '\n';
+    } else {
+        stats.writeJson(report, renderer ? renderer : "unknown", frameWidth, frameHeight);
+    }
+    std::cout << "Flythrough of " << path.size() << " frames on " << (renderer ? renderer : "unknown") << ": p50 " << stats.percentile(50)
+              << " ms, p95 " << stats.percentile(95) << " ms, p99 " << stats.percentile(99) << " ms" << '\n';
+
+    cleanup();
+    // Release the GL objects while the context is still current
+    chunkManager.reset();
+    terrain.reset();
+    gpuNoise.reset();
+    return 0;
+}
+
+// Evaluate the noise of the fixed-size terrain offscreen with GpuNoise and on the CPU, at the sample
+// positions of TerrainMesh::generateBaseTerrain, and print the largest difference. Fails if it is over
+// bound; the README gives the bounds to expect.
+int runGpuNoiseCheck(double bound, double frequency, int octave, double amplitude, double persistence, double lacunarity,
+                     int width, int step, int seed) {
+    OffscreenContext context;
+    if (!context.create(1, 1)) {
+        std::cerr << "--check-gpu-noise needs an offscreen OpenGL context: " << context.getError() << '\n';
+        return 1;
+    }
+    offscreen = true;
+    if (!initGlew()) return 1;
+    ProgramCache programCache(shaderCacheDir);
+    GpuNoise noise;
+    if (!noise.init(programCache)) return 1;
+
+    TerrainMesh mesh;
+    mesh.init(width, step, seed);
+    std::vector<float> gpuHeights;
+    if (!noise.generate(mesh.getNoise(), width, step, frequency, octave, amplitude, persistence, lacunarity, gpuHeights)) return 1;
+
+    const int columns = width / step;
+    std::vector<double> nx(columns), nz(columns), rowNoise(columns);
+    for (int column = 0; column < columns; ++column) {
+        int x = -width / 2 + column * step;
+        nx[column] = static_cast<float>(x) / width;
+    }
+    double maxDifference = 0.0;
+    int worstColumn = 0, worstRow = 0;
+    for (int row = 0; row < columns; ++row) {
+        int z = -width / 2 + row * step;
+        std::fill(nz.begin(), nz.end(), static_cast<float>(z) / width);
+        mesh.getNoise().generateNoiseBatch(nx.data(), nz.data(), 0.5, columns, rowNoise.data(), frequency, amplitude, octave, persistence, lacunarity);
+        for (int column = 0; column < columns; ++column) {
+            float sample = rowNoise[column] + 1.5;
+            double difference = std::abs(static_cast<double>(gpuHeights[static_cast<size_t>(row) * columns + column]) - sample);
+            if (difference > maxDifference) {
+                maxDifference = difference;
+                worstColumn = column;
+                worstRow = row;
+            }
+        }
+    }
+
+    const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    const bool passed = maxDifference <= bound;
+    std::cout << "GPU noise on " << (renderer ? renderer : "unknown") << ": largest difference from the CPU " << maxDifference
+              << " at column " << worstColumn << ", row " << worstRow << " of " << columns << "x" << columns
+              << (passed ? ", within " : ", over ") << bound << '\n';
+    return passed ? 0 : 1;
+}
+
 int main(int argc, char** argv) {
     // Use the command line parser to parse the command line arguments
     CommandLineParser parser;
@@ -246,14 +653,127 @@ int main(int argc, char** argv) {
     int seed = parser.getSeed();
     int width = WIDTH * parser.getWidth();
     int step = width / (32 * std::pow(2, parser.getStep()));
+
+    // An imported height map keeps the grid spacing of --lod; the map size follows from the file
+    std::shared_ptr<const HeightMapFile> heightMapImport;
+    std::string heightMapExportPath = parser.getExportHeightMap();
+    if (parser.isInfinite() && (!parser.getImportHeightMap().empty() || !heightMapExportPath.empty())) {
+        std::cerr << "--import-heightmap and --export-heightmap only apply to the fixed-size terrain, ignoring them with --infinite" << '\n';
+        heightMapExportPath.clear();
+    } else if (!parser.getImportHeightMap().empty()) {
+        auto file = std::make_shared<HeightMapFile>(parser.getImportHeightMap());
+        if (!file->isOpen()) {
+            std::cerr << "Could not import height map " << parser.getImportHeightMap() << ": " << file->getError() << '\n';
+            return 1;
+        }
+        if (file->getColumns() != file->getRows() || file->getColumns() < 2) {
+            std::cerr << "Height maps must be square and at least 2x2, " << parser.getImportHeightMap() << " is "
+                      << file->getColumns() << "x" << file->getRows() << '\n';
+            return 1;
+        }
+        width = file->getColumns() * step;
+        heightMapImport = file;
+    }
     std::cout << "Current Terrain Parameter: Frequency: " << frequency << " Octave: " << octave 
                                         << " Amplitude: " << amplitude << " Persistence: " << persistence 
                                         << " Lacunarity: " << lacunarity << " Seed: " << seed << " Width: " << width
                                         << " Step: " << step << '\n';
 
-    terrain->init(width, step, seed);
+    profilePath = parser.getProfilePath();
+    shaderCacheDir = parser.getShaderCacheDir();
+    compressTextures = parser.useCompressedTextures();
+    lodDistance = static_cast<float>(parser.getLodDistance());
+    compactVertices = parser.useCompactVertices() && !parser.isInfinite();
+    if (parser.useCompactVertices() && parser.isInfinite()) {
+        std::cerr << "--compact-vertices only applies to the fixed-size terrain, ignoring it with --infinite" << '\n';
+    }
+    useGpuNoise = parser.useGpuNoise() && !parser.isInfinite() && !parser.isHeadless();
+    if (parser.useGpuNoise() && (parser.isInfinite() || parser.isHeadless())) {
+        std::cerr << "--gpu-noise needs the fixed-size terrain and a window, ignoring it" << '\n';
+    }
+    if (parser.useNoiseLayers() && (parser.isInfinite() || parser.isHeadless() || !parser.getImportHeightMap().empty())) {
+        std::cerr << "--noise-layers only applies to the generated fixed-size terrain in a window, ignoring it" << '\n';
+    }
+    // The noise layers are summed in double precision, so they take precedence in a window
+    bool floatNoise = parser.useFloatNoise() && !parser.isInfinite() && !heightMapImport && !useGpuNoise &&
+                      !(parser.useNoiseLayers() && !parser.isHeadless());
+    if (parser.useFloatNoise() && !floatNoise) {
+        std::cerr << "--float-noise only applies to the fixed-size terrain generated on the CPU without --noise-layers, ignoring it" << '\n';
+    }
+    int erosionIterations = parser.getErosionIterations();
+    if (erosionIterations > 0 && (parser.isInfinite() || heightMapImport)) {
+        std::cerr << "--erosion only applies to the generated fixed-size terrain, ignoring it" << '\n';
+        erosionIterations = 0;
+    }
+    Profiler::instance().setEnabled(!profilePath.empty());
+
+    // The cache file is named after everything that shapes the generated heightfield
+    std::string cachePath;
+    TerrainKey terrainKey{frequency, amplitude, persistence, lacunarity, octave, width, step, seed, erosionIterations};
+    terrainKey.floatNoise = floatNoise;
+    uint64_t cacheKey = hashTerrainKey(terrainKey);
+    if (!parser.getCacheDir().empty()) {
+        if (heightMapImport) {
+            std::cerr << "--cache does not apply to imported height maps, ignoring it" << '\n';
+        } else if (parser.isInfinite()) {
+            std::cerr << "--cache only applies to the fixed-size terrain, ignoring it with --infinite" << '\n';
+        } else {
+            cachePath = terrainCachePath(parser.getCacheDir(), terrainKey);
+        }
+    }
+
+    // Worker threads for terrain generation, alive for the whole run
+    static ThreadPool pool(parser.getThreads());
+
+    if (parser.getGpuNoiseCheckBound() > 0.0) {
+        return runGpuNoiseCheck(parser.getGpuNoiseCheckBound(), frequency, octave, amplitude, persistence, lacunarity, width, step, seed);
+    }
+
+    if (parser.isHeadless()) {
+        return runHeadless(frequency, octave, amplitude, persistence, lacunarity, width, step, seed, erosionIterations, floatNoise, pool, cachePath, cacheKey,
+                           heightMapImport.get(), heightMapExportPath);
+    }
+
+    if (parser.isInfinite()) {
+        WorldSettings world;
+        world.width = width;
+        world.step = step;
+        world.frequency = frequency;
+        world.amplitude = amplitude;
+        world.persistence = persistence;
+        world.lacunarity = lacunarity;
+        world.octave = octave;
+        world.triangleStrips = parser.useTriangleStrips();
+        chunkGenerator = std::make_shared<ChunkGenerator>(world, seed);
+    } else {
+        terrainParameters = terrainKey;
+        terrainIndexMode = parser.useTriangleStrips() ? TerrainLod::IndexMode::Strips : TerrainLod::IndexMode::Triangles;
+        terrainCacheDir = cachePath.empty() ? std::string() : parser.getCacheDir();
+        terrainPool = &pool;
+        liveTerrainUpdates = !heightMapImport;
+        useNoiseLayers = parser.useNoiseLayers() && liveTerrainUpdates;
+        configureTerrain(*terrain, terrainParameters);
+        terrain->setHeightMapFiles(heightMapImport, heightMapExportPath);
+    }
     lighting->init(width * 0.1f, width / 30);
 
+    if (!parser.getBenchFlythrough().empty()) {
+        std::vector<CameraPose> path;
+        if (parser.getCameraPath().empty()) {
+            path = generateCameraPath(width, parser.getBenchFrames());
+        } else if (!loadCameraPath(parser.getCameraPath(), path)) {
+            return 1;
+        }
+        return runFlythrough(parser.getBenchFlythrough(), path, pool, parser.getViewRadius(),
+                             frequency, octave, amplitude, persistence, lacunarity, width);
+    }
+    if (!parser.getRecordCamera().empty()) {
+        cameraRecording.open(parser.getRecordCamera(), std::ios::app);
+        if (!cameraRecording.is_open()) {
+            std::cerr << "Could not open " << parser.getRecordCamera() << " to record the camera" << '\n';
+        }
+    }
+
     // Initialize GLUT
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
@@ -268,7 +788,16 @@ int main(int argc, char** argv) {
 
     atexit(cleanup); // Register the cleanup function
  
-    init(frequency, octave, amplitude, persistence, lacunarity, width); // Initialize the program
+    {
+        ScopedTimer timer("startup");
+        init(frequency, octave, amplitude, persistence, lacunarity, width, pool); // Initialize the program
+    }
+    if (chunkGenerator) {
+        chunkManager = std::make_unique<ChunkManager>(chunkGenerator, pool, TerrainShaderProgram, parser.getViewRadius());
+    }
+    if (!profilePath.empty()) {
+        Profiler::instance().writeReport(profilePath);
+    }
 
     glutMainLoop(); // Enter the GLUT main event loop
     return 0;
@@ -3,7 +3,6 @@
 
 #include <cmath>
 #include <vector>
-#include <GL/glew.h> // Include appropriate OpenGL headers here
 
 struct Vec {
     float x;
@@ -76,17 +75,17 @@ inline Vec computeFaceNormal(const Vec& v1, const Vec& v2, const Vec& v3) {
 
 // Function to compute vertex normals for a mesh
 inline void computeVertexNormals(
-    const std::vector<GLfloat>& vertices,
-    const std::vector<GLuint>& indices,
-    std::vector<GLfloat>& normals)
+    const std::vector<float>& vertices,
+    const std::vector<unsigned int>& indices,
+    std::vector<float>& normals)
 {
     normals.resize(vertices.size(), 0.0f);
 
     // Traverse all triangles
     for (size_t i = 0; i < indices.size(); i += 3) {
-        GLuint index1 = indices[i] * 6; // Assuming each vertex has 6 components (x, y, z, nx, ny, nz)
-        GLuint index2 = indices[i + 1] * 6;
-        GLuint index3 = indices[i + 2] * 6;
+        unsigned int index1 = indices[i] * 6; // Assuming each vertex has 6 components (x, y, z, nx, ny, nz)
+        unsigned int index2 = indices[i + 1] * 6;
+        unsigned int index3 = indices[i + 2] * 6;
 
         Vec v1 = {vertices[index1], vertices[index1 + 1], vertices[index1 + 2]};
         Vec v2 = {vertices[index2], vertices[index2 + 1], vertices[index2 + 2]};
@@ -117,11 +116,102 @@ inline void computeVertexNormals(
     }
 }
 
-// Function to convert a GLdouble matrix to GLfloat
-inline void convertMatrix(GLdouble* source, GLfloat* dest) {
-    for (int i = 0; i < 16; ++i) {
-        dest[i] = static_cast<GLfloat>(source[i]);
+// Column-major perspective projection, the matrix gluPerspective builds (worked out in double like GLU)
+inline void perspectiveMatrix(double fovyDegrees, double aspect, double zNear, double zFar, float* dest) {
+    const double f = 1.0 / std::tan(fovyDegrees * M_PI / 360.0);
+    for (int i = 0; i < 16; ++i) dest[i] = 0.0f;
+    dest[0] = static_cast<float>(f / aspect);
+    dest[5] = static_cast<float>(f);
+    dest[10] = static_cast<float>((zFar + zNear) / (zNear - zFar));
+    dest[11] = -1.0f;
+    dest[14] = static_cast<float>(2.0 * zFar * zNear / (zNear - zFar));
+}
+
+// Column-major view matrix, the matrix gluLookAt builds (worked out in double like GLU)
+inline void lookAtMatrix(const Vec& eye, const Vec& center, const Vec& up, float* dest) {
+    double forward[3] = {double(center.x) - eye.x, double(center.y) - eye.y, double(center.z) - eye.z};
+    double length = std::sqrt(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+    for (double& v : forward) v /= length;
+    // side = forward x up, normalized; upward = side x forward
+    double side[3] = {forward[1] * up.z - forward[2] * up.y, forward[2] * up.x - forward[0] * up.z, forward[0] * up.y - forward[1] * up.x};
+    length = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+    for (double& v : side) v /= length;
+    const double upward[3] = {side[1] * forward[2] - side[2] * forward[1], side[2] * forward[0] - side[0] * forward[2],
+                              side[0] * forward[1] - side[1] * forward[0]};
+    const double position[3] = {eye.x, eye.y, eye.z};
+    double translation[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i < 3; ++i) {
+        dest[i * 4 + 0] = static_cast<float>(side[i]);
+        dest[i * 4 + 1] = static_cast<float>(upward[i]);
+        dest[i * 4 + 2] = static_cast<float>(-forward[i]);
+        dest[i * 4 + 3] = 0.0f;
+        translation[0] -= side[i] * position[i];
+        translation[1] -= upward[i] * position[i];
+        translation[2] += forward[i] * position[i];
+    }
+    dest[12] = static_cast<float>(translation[0]);
+    dest[13] = static_cast<float>(translation[1]);
+    dest[14] = static_cast<float>(translation[2]);
+    dest[15] = 1.0f;
+}
+
+// dest = a * b for column-major 4x4 matrices; dest must not alias a or b
+inline void multiplyMatrix(const float* a, const float* b, float* dest) {
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            }
+            dest[column * 4 + row] = sum;
+        }
+    }
+}
+
+// View frustum as six planes (a, b, c, d); a point is inside when a*x + b*y + c*z + d >= 0 for all of them
+struct Frustum {
+    float planes[6][4];
+};
+
+enum class FrustumTest { Outside, Intersect, Inside };
+
+// Function to extract the frustum planes from column-major projection and view matrices
+inline Frustum extractFrustum(const float* projection, const float* view) {
+    float clip[16];
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                sum += projection[k * 4 + row] * view[column * 4 + k];
+            }
+            clip[column * 4 + row] = sum;
+        }
+    }
+
+    // Left/right, bottom/top and near/far are the last row plus/minus the first three rows
+    Frustum frustum;
+    for (int i = 0; i < 3; ++i) {
+        for (int column = 0; column < 4; ++column) {
+            frustum.planes[i * 2][column] = clip[column * 4 + 3] + clip[column * 4 + i];
+            frustum.planes[i * 2 + 1][column] = clip[column * 4 + 3] - clip[column * 4 + i];
+        }
     }
+    return frustum;
+}
+
+// Function to classify an axis-aligned box against the frustum
+inline FrustumTest testBoxInFrustum(const Frustum& frustum, const Vec& boxMin, const Vec& boxMax) {
+    FrustumTest result = FrustumTest::Inside;
+    for (const auto& plane : frustum.planes) {
+        // Box corners furthest along and against the plane normal
+        float farthest = plane[0] * (plane[0] >= 0 ? boxMax.x : boxMin.x) + plane[1] * (plane[1] >= 0 ? boxMax.y : boxMin.y) +
+                         plane[2] * (plane[2] >= 0 ? boxMax.z : boxMin.z) + plane[3];
+        float nearest = plane[0] * (plane[0] >= 0 ? boxMin.x : boxMax.x) + plane[1] * (plane[1] >= 0 ? boxMin.y : boxMax.y) +
+                        plane[2] * (plane[2] >= 0 ? boxMin.z : boxMax.z) + plane[3];
+        if (farthest < 0) return FrustumTest::Outside;
+        if (nearest < 0) result = FrustumTest::Intersect;
+    }
+    return result;
 }
 
 #endif // MATH_HPP
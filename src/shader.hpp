@@ -9,6 +9,7 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include "TextureCache.hpp"
 
 // Check for OpenGL errors
 inline void checkGLError(const char* stmt, const char* fname, int line) {
@@ -108,58 +109,10 @@ inline GLuint loadShaderFromFile(const std::string& filePath, GLenum shaderType)
     return loadShader(shaderSource.c_str(), shaderType);
 }
 
-// Load texture from file
-inline GLuint loadTexture(const std::filesystem::path& imagepath) {
-    std::cout << "Reading image " << imagepath << '\n';
-
-    FILE* file = fopen(imagepath.string().c_str(), "rb");
-    if (!file) {
-        std::cerr << "Image could not be opened: " << imagepath << '\n';
-        return 0;
-    }
-
-    // Load the BMP file header
-    unsigned char header[54];
-    if (fread(header, 1, 54, file) != 54) {
-        std::cerr << "Not a correct BMP file: " << imagepath << '\n';
-        fclose(file);
-        return 0;
-    }
-
-    if (header[0] != 'B' || header[1] != 'M') {
-        std::cerr << "Not a correct BMP file: " << imagepath << '\n';
-        fclose(file);
-        return 0;
-    }
-
-    // Get image information
-    unsigned int dataPos = *(int*)&(header[0x0A]);
-    unsigned int imageSize = *(int*)&(header[0x22]);
-    unsigned int width = *(int*)&(header[0x12]);
-    unsigned int height = *(int*)&(header[0x16]);
-
-    // Correct image size if it is not present in the header
-    if (imageSize == 0) imageSize = width * height * 3;
-    if (dataPos == 0) dataPos = 54;
-
-    // Set the file position to the beginning of the image data
-    std::vector<unsigned char> data(imageSize);
-
-    // Load the image data
-    if (fread(data.data(), 1, imageSize, file) != imageSize) {
-        std::cerr << "Error reading image data: " << imagepath << '\n';
-        fclose(file);
-        return 0;
-    }
-
-    // Close the file
-    fclose(file);
-
-    // Create OpenGL texture
+// Upload every level of a MipTexture, which saves building the mipmaps at startup
+inline GLuint loadTexture(const MipTexture& texture) {
     GLuint textureID;
     glGenTextures(1, &textureID);
-
-    // Bind the texture
     glBindTexture(GL_TEXTURE_2D, textureID);
 
     // Set the texture wrapping/filtering options (on the currently bound texture object)
@@ -167,9 +120,20 @@ inline GLuint loadTexture(const std::filesystem::path& imagepath) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // 设置为使用 Mipmap 的线性过滤器
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // Load and generate the texture
-    gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGB, width, height, GL_BGR, GL_UNSIGNED_BYTE, data.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.getLevelCount() - 1);
+
+    // RGB8 rows of odd levels are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = 0; level < texture.getLevelCount(); ++level) {
+        const TextureLevel& entry = texture.getLevel(level);
+        if (texture.getFormat() == TextureFormat::Bc1) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, entry.width, entry.height, 0,
+                                   static_cast<GLsizei>(entry.size), texture.getLevelData(level));
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGB8, entry.width, entry.height, 0, GL_RGB, GL_UNSIGNED_BYTE, texture.getLevelData(level));
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     // Check for OpenGL errors
     GLenum error = glGetError();
@@ -179,8 +143,6 @@ inline GLuint loadTexture(const std::filesystem::path& imagepath) {
         return 0;
     }
 
-    std::cout << "Successfully loaded " << imagepath << '\n';
-
     return textureID;
 }
 